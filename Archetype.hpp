@@ -0,0 +1,121 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <algorithm>
+#include <typeinfo>
+#include <stdexcept>
+#include <new>
+
+#include "IComponent.hpp"
+#include "Pool.hpp"
+
+namespace kengine {
+    class GameObject;
+    class ComponentManager;
+
+    // Type-erased contiguous storage for all the Components of a given type in an Archetype
+    class ComponentColumn {
+    public:
+        virtual ~ComponentColumn() = default;
+
+    public:
+        virtual std::unique_ptr<ComponentColumn> makeEmpty() const = 0;
+
+        virtual std::size_t size() const noexcept = 0;
+        virtual void reserve(std::size_t capacity) = 0;
+        virtual IComponent & at(std::size_t row) noexcept = 0;
+
+        // Move-constructs a new element at the back of the column from comp
+        virtual IComponent & adopt(IComponent && comp) = 0;
+        // Move-constructs a new element at the back of the column from other's element at row
+        virtual IComponent & moveFrom(ComponentColumn & other, std::size_t row) = 0;
+        // Moves the element at row into a heap-allocated Component, leaving a moved-from element behind
+        virtual std::shared_ptr<IComponent> extract(std::size_t row) = 0;
+        // Destroys the element at row and moves the last element into its place
+        virtual void swapRemove(std::size_t row) noexcept = 0;
+    };
+
+    template<typename CT>
+    class TypedColumn final : public ComponentColumn {
+    public:
+        std::unique_ptr<ComponentColumn> makeEmpty() const final { return std::make_unique<TypedColumn>(); }
+
+        std::size_t size() const noexcept final { return _data.size(); }
+        void reserve(std::size_t capacity) final { _data.reserve(capacity); }
+        IComponent & at(std::size_t row) noexcept final { return _data[row]; }
+
+        IComponent & adopt(IComponent && comp) final {
+            if (typeid(comp) != typeid(CT))
+                throw std::logic_error(
+                        "[kengine] Components must be attached as their most-derived type when using archetype storage"
+                );
+            _data.emplace_back(std::move(static_cast<CT &>(comp)));
+            return _data.back();
+        }
+
+        IComponent & moveFrom(ComponentColumn & other, std::size_t row) final {
+            auto & source = static_cast<TypedColumn &>(other);
+            _data.emplace_back(std::move(source._data[row]));
+            return _data.back();
+        }
+
+        std::shared_ptr<IComponent> extract(std::size_t row) final {
+            return std::allocate_shared<CT>(PoolAllocator<CT>(), std::move(_data[row]));
+        }
+
+        void swapRemove(std::size_t row) noexcept final {
+            // Destroy and re-construct in place, as Components with const members can't be move-assigned
+            if (row != _data.size() - 1) {
+                _data[row].~CT();
+                new (&_data[row]) CT(std::move(_data.back()));
+            }
+            _data.pop_back();
+        }
+
+    public:
+        CT * data() noexcept { return _data.data(); }
+
+    private:
+        std::vector<CT> _data;
+    };
+
+    // Group of GameObjects sharing the exact same set of Component types
+    class Archetype {
+    public:
+        using Signature = std::vector<pmeta::type_index>; // Sorted
+
+        Archetype(const Signature & signature) : _signature(signature) {}
+
+    public:
+        const Signature & getSignature() const noexcept { return _signature; }
+
+        bool hasType(pmeta::type_index type) const noexcept {
+            return std::binary_search(_signature.begin(), _signature.end(), type);
+        }
+
+        std::size_t size() const noexcept { return _entities.size(); }
+        bool empty() const noexcept { return _entities.empty(); }
+
+        const std::vector<GameObject *> & getGameObjects() const noexcept { return _entities; }
+
+        // Returns the contiguous array of CTs for this archetype, indexed like getGameObjects()
+        // Returns nullptr if CT isn't part of the archetype or can't be stored contiguously (i.e. isn't move-constructible)
+        template<typename CT>
+        CT * getComponents() noexcept {
+            const auto it = _columns.find(pmeta::type<CT>::index);
+            if (it == _columns.end())
+                return nullptr;
+            return static_cast<TypedColumn<CT> &>(*it->second).data();
+        }
+
+    private:
+        friend class ComponentManager;
+
+        Signature _signature;
+        std::vector<GameObject *> _entities;
+        std::unordered_map<pmeta::type_index, std::unique_ptr<ComponentColumn>> _columns;
+        std::size_t _capacity = 0;
+    };
+}
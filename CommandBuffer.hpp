@@ -0,0 +1,160 @@
+#pragma once
+
+#include <tuple>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <functional>
+#include "GameObject.hpp"
+#include "EntityHandle.hpp"
+
+namespace kengine {
+    namespace detail {
+        // Where commands are recorded from, so that they are played back in an order that doesn't depend on scheduling
+        struct CommandOrigin {
+            std::size_t system = 0; // 1 + position of the System in the SystemManager's order, 0 outside of Systems
+            // Even for the segments of the System's body between parallelFor calls, odd for the chunks of each call
+            std::size_t sequence = 0;
+            std::size_t chunk = 0; // 1 + first index of the parallelFor chunk, 0 outside of parallelFor
+
+            bool operator<(const CommandOrigin & rhs) const noexcept {
+                return std::tie(system, sequence, chunk) < std::tie(rhs.system, rhs.sequence, rhs.chunk);
+            }
+        };
+
+        // Set by the SystemManager for the System and parallelFor chunk running on this thread
+        inline CommandOrigin & currentCommandOrigin() noexcept {
+            static thread_local CommandOrigin origin;
+            return origin;
+        }
+
+        struct Command {
+            enum class Type { Create, Remove, Attach, Detach, Enable, Disable };
+
+            Type type = Type::Create;
+            EntityHandle handle = {};
+            std::function<void(GameObject &)> func = nullptr; // postCreate for Create, attachComponent for Attach
+            std::string name = ""; // For Create
+            pmeta::type_index component = 0; // For Detach
+            CommandOrigin origin = currentCommandOrigin();
+        };
+
+        // One buffer per thread of the SystemManager's ThreadPool, so recording never requires synchronization
+        // Threads that don't run Systems share an extra buffer, behind a mutex
+        class CommandBuffers {
+        public:
+            CommandBuffers(std::size_t threads = 1) : _buffers(std::max<std::size_t>(threads, 1)) {}
+
+            // Passed as thread by threads that don't run Systems, see SystemManager::isSystemThread
+            static constexpr auto LOCKED = std::numeric_limits<std::size_t>::max();
+
+            // thread must be the caller's index in the SystemManager's ThreadPool, or LOCKED
+            void push(std::size_t thread, Command && command) {
+                if (thread != LOCKED) {
+                    _buffers[thread].commands.push_back(std::move(command));
+                    return;
+                }
+
+                {
+                    std::lock_guard<std::mutex> lock(_lockedMutex);
+                    _locked.push_back(std::move(command));
+                }
+                if (onLockedPush != nullptr)
+                    onLockedPush();
+            }
+
+            // Called after a command is pushed by a thread that doesn't run Systems, e.g. to wake the SystemManager up
+            std::function<void()> onLockedPush = nullptr;
+
+            // Buffers are never removed, as they may still hold commands
+            void setThreadCount(std::size_t threads) {
+                if (threads > _buffers.size())
+                    _buffers.resize(threads);
+            }
+
+            bool empty() const {
+                if (!std::all_of(_buffers.begin(), _buffers.end(), [](const Buffer & b) { return b.commands.empty(); }))
+                    return false;
+                std::lock_guard<std::mutex> lock(_lockedMutex);
+                return _locked.empty();
+            }
+
+            // Returns the commands recorded since the last call, sorted by origin
+            // A chunk runs on a single thread, so commands with the same origin keep the order in which they were recorded
+            std::vector<Command> take() {
+                std::vector<Command> ret;
+                for (auto & buffer : _buffers) {
+                    std::move(buffer.commands.begin(), buffer.commands.end(), std::back_inserter(ret));
+                    buffer.commands.clear();
+                }
+                {
+                    std::lock_guard<std::mutex> lock(_lockedMutex);
+                    std::move(_locked.begin(), _locked.end(), std::back_inserter(ret));
+                    _locked.clear();
+                }
+                std::stable_sort(ret.begin(), ret.end(), [](const Command & lhs, const Command & rhs) { return lhs.origin < rhs.origin; });
+                return ret;
+            }
+
+        private:
+            struct alignas(64) Buffer { // Avoid false sharing between threads recording to neighbouring buffers
+                std::vector<Command> commands;
+            };
+
+            std::vector<Buffer> _buffers;
+            mutable std::mutex _lockedMutex;
+            std::vector<Command> _locked;
+        };
+    }
+
+    // Records structural changes from any of the SystemManager's threads, without locking
+    // Other threads may record too, through a shared buffer behind a mutex
+    // Commands are played back by the EntityManager at the next sync point, see EntityManager::getCommandBuffer
+    // Commands targeting GameObjects that no longer exist by then are ignored
+    class CommandBuffer {
+    public:
+        CommandBuffer(detail::CommandBuffers & buffers, std::size_t thread) noexcept : _buffers(buffers), _thread(thread) {}
+
+    public:
+        // postCreate is called during playback, and may attach Components
+        void createEntity(const std::string & name = "", const std::function<void(GameObject &)> & postCreate = nullptr) {
+            push(detail::Command{ detail::Command::Type::Create, {}, postCreate, name });
+        }
+
+        void removeEntity(EntityHandle handle) { push(detail::Command{ detail::Command::Type::Remove, handle }); }
+
+        // The Component is constructed from a copy of args during playback
+        template<typename CT, typename ...Args>
+        void attachComponent(EntityHandle handle, Args && ...args) {
+            static_assert(std::is_base_of<IComponent, CT>::value,
+                          "Attempt to attach something that's not a component");
+
+            push(detail::Command{
+                    detail::Command::Type::Attach, handle,
+                    [args = std::make_tuple(FWD(args)...)](GameObject & go) mutable {
+                        std::apply([&go](auto && ...params) { go.attachComponent<CT>(FWD(params)...); }, std::move(args));
+                    }
+            });
+        }
+
+        template<typename CT>
+        void detachComponent(EntityHandle handle) {
+            static_assert(std::is_base_of<IComponent, CT>::value,
+                          "Attempt to detach something that's not a component");
+            push(detail::Command{ detail::Command::Type::Detach, handle, nullptr, "", pmeta::type<CT>::index });
+        }
+
+        void enableEntity(EntityHandle handle) { push(detail::Command{ detail::Command::Type::Enable, handle }); }
+        void disableEntity(EntityHandle handle) { push(detail::Command{ detail::Command::Type::Disable, handle }); }
+
+    private:
+        void push(detail::Command && command) { _buffers.push(_thread, std::move(command)); }
+
+    private:
+        detail::CommandBuffers & _buffers;
+        std::size_t _thread;
+    };
+}
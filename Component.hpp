@@ -5,12 +5,60 @@
 #pragma once
 
 #include <string>
+#include <type_traits>
+#include <stdexcept>
 #include "IComponent.hpp"
+#include "Pool.hpp"
 
 namespace kengine {
     template<typename CRTP, typename ...DataPackets>
     class Component : public IComponent, public putils::Module<CRTP, DataPackets...> {
     public:
         pmeta::type_index getType() const noexcept final { return pmeta::type<CRTP>::index; }
+        const char * getName() const noexcept final { return detail::getClassName<CRTP>(); }
+        std::size_t getComponentId() const noexcept final { return detail::componentId<CRTP>(); }
+        bool handlesPackets() const noexcept final { return sizeof...(DataPackets) > 0; }
+
+        // Throws std::logic_error if CRTP isn't copy-constructible
+        void attachCopyTo(GameObject & go) const final;
+        bool isCopyable() const noexcept final { return std::is_copy_constructible<CRTP>::value; }
+
+        // Heap data is found by walking CRTP's reflectible attributes
+        // Components owning data that isn't reflected (or large std::function captures) should override this to add it
+        MemoryUsage getMemoryUsage() const noexcept override {
+            MemoryUsage ret;
+            ret.objectBytes = sizeof(CRTP);
+            detail::addHeapUsage(static_cast<const CRTP &>(*this), ret);
+            return ret;
+        }
+
+    private:
+        void markTypeChanged(std::uint64_t tick) noexcept final {
+            auto & typeTick = detail::typeChangeTick<CRTP>();
+            auto current = typeTick.load(std::memory_order_relaxed);
+            while (current < tick && !typeTick.compare_exchange_weak(current, tick, std::memory_order_relaxed));
+
+            detail::logChange(*this, detail::componentId<CRTP>(), tick);
+            if (const auto listener = detail::changeListener<CRTP>().load(std::memory_order_relaxed))
+                listener(*this);
+        }
+
+    public:
+        // Components are allocated from a pool dedicated to their type
+        static void * operator new(std::size_t size) { return poolAllocate<CRTP>(size); }
+        static void operator delete(void * p, std::size_t size) noexcept { poolDeallocate<CRTP>(p, size); }
+
+        static void * operator new(std::size_t, void * where) noexcept { return where; }
+        static void operator delete(void *, void *) noexcept {}
     };
 }
+
+#include "GameObject.hpp"
+
+template<typename CRTP, typename ...DataPackets>
+void kengine::Component<CRTP, DataPackets...>::attachCopyTo(GameObject & go) const {
+    if constexpr (std::is_copy_constructible<CRTP>::value)
+        go.attachComponent(std::make_unique<CRTP>(static_cast<const CRTP &>(*this)));
+    else
+        throw std::logic_error("[kengine] Attempt to copy a Component that isn't copy-constructible");
+}
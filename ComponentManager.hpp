@@ -1,8 +1,22 @@
 #pragma once
 
+#include <map>
+#include <mutex>
+#include <algorithm>
+#include <typeinfo>
 #include "Component.hpp"
+#include "Archetype.hpp"
+#include "Query.hpp"
+#include "SparseSet.hpp"
+#include "SystemStats.hpp"
+#include "IComponentRegistry.hpp"
 
 namespace kengine {
+    enum class ComponentStorage {
+        PerEntity, // Each Component is heap-allocated and owned by its GameObject
+        Archetypes // Components are stored contiguously, grouped by GameObjects' sets of Component types
+    };
+
     class ComponentManager {
     public:
         template<class CT, typename ...Params>
@@ -16,60 +30,740 @@ namespace kengine {
         }
 
     public:
-        const GameObject & getParent(const IComponent & comp) const { return *_compHierarchy.at(&comp); }
+        // Throws std::out_of_range if comp isn't attached to a GameObject
+        const GameObject & getParent(const IComponent & comp) const {
+            if (comp._owner == nullptr)
+                throw std::out_of_range("[kengine] Attempt to get the parent of a Component that isn't attached");
+            return *comp._owner;
+        }
 
     public:
+        // getGameObjects<Changed<T>>() returns a QueryView<T> over the GameObjects whose T changed since the calling System last ran
         template<typename T>
-        const std::vector<GameObject *> & getGameObjects() noexcept {
-            static_assert(kengine::is_component<T>::value,
-                          "getGameObjects called without component type");
-            return _entitiesByType[pmeta::type<T>::index].safe;
+        decltype(auto) getGameObjects() noexcept {
+            if constexpr (detail::is_changed<T>::value) {
+                const auto has = [](const GameObject & go) { return go.hasComponent<std::remove_const_t<typename T::type>>(); };
+                return QueryViewFor<T>(filterChanged(getGameObjects<typename T::type>(), has, (detail::changed_types<T> *)nullptr));
+            }
+            else {
+                static_assert(kengine::is_component<T>::value,
+                              "getGameObjects called without component type");
+                const auto lock = lockLists();
+                const auto & ret = _entitiesByType[pmeta::type<std::remove_const_t<T>>::index].safe;
+                countVisited(ret.size());
+                return ret;
+            }
+        }
+
+        const std::vector<GameObject *> & getGameObjects() const noexcept {
+            countVisited(_allEntities.safe.size());
+            return _allEntities.safe;
         }
 
-        const std::vector<GameObject *> & getGameObjects() const noexcept { return _allEntities.safe; }
+        // Returns a view over all the GameObjects with all the Components in Ts, except those excluded with Without<T>
+        // The view yields an std::tuple<GameObject &, Components &...> for each GameObject
+        // Const Components are obtained without being marked as changed, and Changed<T> only keeps GameObjects whose T changed
+        template<typename T, typename U, typename ...Ts>
+        QueryViewFor<T, U, Ts...> getGameObjects() noexcept {
+            const auto & query = getQuery<detail::query_type_t<T>, detail::query_type_t<U>, detail::query_type_t<Ts>...>();
+            const auto & entities = query.safe;
+            countVisited(entities.size());
 
+            using Changed = detail::changed_types<T, U, Ts...>;
+            if constexpr (std::tuple_size<Changed>::value > 0) {
+                const auto matches = [&query](const GameObject & go) { return query.matches(go.getSignature()); };
+                return QueryViewFor<T, U, Ts...>(filterChanged(entities, matches, (Changed *)nullptr));
+            }
+            else
+                return QueryViewFor<T, U, Ts...>(entities);
+        }
+
+        // Only copies the lists that were modified since the last call
 		void updateEntitiesByType() noexcept {
-			_allEntities.safe = _allEntities.unsafe;
-			for (auto & [type, category] : _entitiesByType)
-				category.safe = category.unsafe;
+			for (const auto collection : _dirtyCollections) {
+				collection->safe = collection->unsafe.getDense();
+				collection->dirty = false;
+			}
+			_dirtyCollections.clear();
+        }
+
+    public:
+        // Must be called before any GameObject is registered
+        void setComponentStorage(ComponentStorage storage) {
+            if (!_allEntities.unsafe.empty())
+                throw std::logic_error("[kengine] Component storage can only be changed before GameObjects are registered");
+            _storage = storage;
+        }
+
+        ComponentStorage getComponentStorage() const noexcept { return _storage; }
+
+        const std::vector<std::unique_ptr<Archetype>> & getArchetypes() const noexcept { return _archetypes; }
+
+        // Registry must be a ComponentRegistry<Components...>, which is then kept up to date with the enabled GameObjects
+        // Must be called before any GameObject is registered
+        template<typename Registry>
+        Registry & setComponentRegistry() {
+            static_assert(std::is_base_of<IComponentRegistry, Registry>::value,
+                          "Attempt to set something that's not a ComponentRegistry");
+            if (!_allEntities.unsafe.empty())
+                throw std::logic_error("[kengine] Component registry can only be set before GameObjects are registered");
+            auto registry = std::make_unique<Registry>();
+            auto & ret = *registry;
+            _registry = std::move(registry);
+            return ret;
+        }
+
+        // Throws std::out_of_range if no Registry was set
+        template<typename Registry>
+        Registry & getComponentRegistry() {
+            const auto ret = dynamic_cast<Registry *>(_registry.get());
+            if (ret == nullptr)
+                throw std::out_of_range("[kengine] No such Component registry");
+            return *ret;
+        }
+
+        // Calls func(GameObject &, Components &...) for each enabled GameObject matching Ts (which may contain Without<T>s)
+        // With ComponentStorage::Archetypes, this walks each matching archetype's contiguous arrays.
+        // func must not attach or detach Components, as that would move GameObjects between archetypes
+        template<typename ...Ts, typename Func>
+        void forEach(Func && func) {
+            forEachMatching<Ts...>(func, (detail::required_types<Ts...> *)nullptr);
+        }
+
+    private:
+        template<typename ...Ts, typename Func, typename ...Required>
+        void forEachMatching(Func & func, std::tuple<Required...> *) {
+            static_assert(sizeof...(Required) > 0, "forEach called without component type");
+            static_assert(std::conjunction<kengine::is_component<Required>...>::value,
+                          "forEach called with something that's not a component");
+            static_assert(!std::disjunction<detail::is_changed<Ts>...>::value,
+                          "forEach doesn't support Changed<T>, use getGameObjects");
+
+            if (_storage == ComponentStorage::PerEntity) {
+                for (const auto go : getEntityList<detail::query_type_t<Ts>...>())
+                    func(*go, detail::getRequired<Required>(*go)...);
+                return;
+            }
+
+            const auto & query = getQuery<detail::query_type_t<Ts>...>();
+            for (const auto & archetype : _archetypes) {
+                if (archetype->empty() || !query.matches(archetype->getSignature()))
+                    continue;
+                countVisited(archetype->size());
+
+                const auto & entities = archetype->getGameObjects();
+                const auto columns = std::make_tuple(archetype->template getComponents<std::remove_const_t<Required>>()...);
+                for (std::size_t i = 0; i < entities.size(); ++i)
+                    if (entities[i]->_enabled) // Disabled GameObjects keep their row
+                        func(*entities[i], getComponentAt<Required>(std::get<std::remove_const_t<Required> *>(columns), i, *entities[i])...);
+            }
+
+            countVisited(_looseEntities.size());
+            for (const auto go : _looseEntities)
+                if (go->_enabled && query.matches(go->_signature))
+                    func(*go, detail::getRequired<Required>(*go)...);
+        }
+
+        // Keeps the GameObjects whose Changed Components were all changed since the System executing on this thread last ran
+        // Walks the shortest of the Changed types' change lists when it is shorter than entities, see ChangeList
+        // matches(const GameObject &) tells whether a GameObject from a change list belongs to the query
+        template<typename Matches, typename ...Changed>
+        std::vector<GameObject *> filterChanged(const std::vector<GameObject *> & entities, const Matches & matches, std::tuple<Changed...> *) {
+            const auto lastRun = detail::currentSystemTicks().lastRun;
+            std::vector<GameObject *> ret;
+            if (((detail::typeChangeTick<Changed>().load(std::memory_order_relaxed) <= lastRun) || ...))
+                return ret;
+
+            const auto changed = [lastRun](const GameObject & go) {
+                return ((go.getComponent<Changed>().getChangeTick() > lastRun) && ...);
+            };
+
+            std::vector<EntityHandle> handles;
+            if (!getChangedHandles({ detail::componentId<Changed>()... }, lastRun, entities.size(), handles)) {
+                for (const auto go : entities)
+                    if (changed(*go))
+                        ret.push_back(go);
+                return ret;
+            }
+
+            const auto lock = lockLists();
+            for (const auto handle : handles) {
+                const auto go = _allEntities.unsafe.find(handle); // Only holds enabled GameObjects
+                if (go != nullptr && matches(*go) && changed(*go))
+                    ret.push_back(go);
+            }
+            return ret;
+        }
+
+        // Accounts for entities visited by the System currently executing on this thread, see SystemManager::setStatsEnabled
+        static void countVisited(std::size_t count) noexcept {
+#ifndef KENGINE_NO_STATS
+            if (const auto stats = detail::currentStatsRecorder())
+                stats->entitiesVisited += count;
+#endif
+        }
+
+        template<typename CT>
+        static CT & getComponentAt(std::remove_const_t<CT> * column, std::size_t row, GameObject & go) {
+            if (column == nullptr)
+                return detail::getRequired<CT>(go);
+            if constexpr (!std::is_const<CT>::value)
+                column[row].markChanged();
+            return column[row];
+        }
+
+        template<typename ...Ts>
+        const std::vector<GameObject *> & getEntityList() noexcept {
+            using First = std::tuple_element_t<0, std::tuple<Ts...>>;
+            if constexpr (sizeof...(Ts) == 1 && !detail::is_without<First>::value)
+                return getGameObjects<First>();
+            else {
+                const auto & ret = getQuery<Ts...>().safe;
+                countVisited(ret.size());
+                return ret;
+            }
+        }
+
+        template<typename ...Ts>
+        CachedQuery & getQuery() noexcept {
+            const auto lock = lockLists();
+            const auto key = pmeta::type<std::tuple<Ts...>>::index;
+            const auto it = _queries.find(key);
+            if (it != _queries.end())
+                return *it->second;
+
+            using Required = detail::required_types<Ts...>;
+            using Excluded = detail::excluded_types<Ts...>;
+            static_assert(std::tuple_size<Required>::value > 0, "Queries must require at least one component type");
+
+            auto query = std::make_unique<CachedQuery>(
+                    detail::getTypeIndexes((Required *)nullptr), detail::getTypeIndexes((Excluded *)nullptr)
+            );
+            for (const auto go : _allEntities.unsafe)
+                if (query->matches(go->_signature))
+                    query->unsafe.insert(*go);
+            query->safe = query->unsafe.getDense();
+
+            auto & ret = *query;
+            for (const auto type : ret.required)
+                _queriesByType[type].push_back(&ret);
+            for (const auto type : ret.excluded)
+                _queriesByType[type].push_back(&ret);
+            _queries.emplace(key, std::move(query));
+            return ret;
+        }
+
+    protected:
+        // Set while Systems may be running concurrently, so that lists and queries can be lazily created from any thread
+        void setConcurrentAccess(bool concurrent) noexcept { _concurrentAccess = concurrent; }
+
+    private:
+        std::unique_lock<std::mutex> lockLists() noexcept {
+            if (_concurrentAccess)
+                return std::unique_lock<std::mutex>(_listsMutex);
+            return std::unique_lock<std::mutex>();
+        }
+
+        /*
+         * Change lists
+         */
+
+    private:
+        // Handles of the GameObjects whose Component of a given type got a new change tick, appended by Component::markTypeChanged
+        // A GameObject appears once per tick at which it changed. Entries are dropped once no System can ask for them, see pruneChanges
+        // Types are only tracked once they were queried with Changed<T>, so other Components don't pay for it
+        struct ChangeList {
+            struct Entry {
+                EntityHandle handle;
+                std::uint64_t tick;
+            };
+
+            std::atomic<bool> tracked{ false };
+            std::mutex mutex;
+            std::vector<Entry> entries;
+            std::uint64_t horizon = 0; // Every change after this tick is in entries
+        };
+
+        friend void detail::logChange(const IComponent & comp, std::size_t componentId, std::uint64_t tick) noexcept;
+
+        static void logChange(const IComponent & comp, std::size_t componentId, std::uint64_t tick) noexcept {
+            const auto go = comp._owner;
+            if (go != nullptr && go->_manager != nullptr && go->_handle.isValid())
+                go->_manager->appendChange(componentId, go->_handle, tick);
+        }
+
+        void appendChange(std::size_t componentId, EntityHandle handle, std::uint64_t tick) noexcept {
+            auto & list = _changeLists[componentId];
+            if (!list.tracked.load())
+                return;
+            const std::lock_guard<std::mutex> lock(list.mutex);
+            list.entries.push_back({ handle, tick });
+        }
+
+        // Fills handles with the GameObjects in the shortest of the change lists for componentIds that changed after lastRun,
+        // sorted and without duplicates
+        // Returns false if that list was pruned past lastRun, or isn't shorter than the queryCount GameObjects it would replace
+        bool getChangedHandles(std::initializer_list<std::size_t> componentIds, std::uint64_t lastRun, std::size_t queryCount,
+                               std::vector<EntityHandle> & handles) {
+            ChangeList * shortest = nullptr;
+            auto shortestSize = queryCount;
+            bool usable = true;
+            for (const auto id : componentIds) {
+                if (id >= ComponentSignature::SIZE)
+                    return false;
+                auto & list = _changeLists[id];
+                const std::lock_guard<std::mutex> lock(list.mutex);
+                if (!list.tracked.load()) {
+                    // Changes made after the counter is read are logged, as it is read once tracked is set
+                    list.tracked = true;
+                    list.horizon = detail::changeTickCounter().load();
+                    usable = false;
+                }
+                else if (list.horizon > lastRun)
+                    usable = false;
+                else if (list.entries.size() < shortestSize) {
+                    shortest = &list;
+                    shortestSize = list.entries.size();
+                }
+            }
+            if (!usable || shortest == nullptr)
+                return false;
+
+            {
+                const std::lock_guard<std::mutex> lock(shortest->mutex);
+                for (const auto & entry : shortest->entries)
+                    if (entry.tick > lastRun)
+                        handles.push_back(entry.handle);
+            }
+
+            std::sort(handles.begin(), handles.end(), [](EntityHandle lhs, EntityHandle rhs) { return lhs.getId() < rhs.getId(); });
+            handles.erase(std::unique(handles.begin(), handles.end()), handles.end());
+            return true;
+        }
+
+    protected:
+        // Drops the changes made at or before tick, which must be at most the last tick at which any System started executing
+        // Called between Systems, see SystemManager::getOldestRunTick
+        void pruneChanges(std::uint64_t tick) noexcept {
+            for (std::size_t i = 0; i < ComponentSignature::SIZE; ++i) {
+                auto & list = _changeLists[i];
+                if (!list.tracked.load(std::memory_order_relaxed))
+                    continue;
+                const std::lock_guard<std::mutex> lock(list.mutex);
+                if (list.horizon >= tick)
+                    continue;
+                list.entries.erase(std::remove_if(list.entries.begin(), list.entries.end(), [tick](const ChangeList::Entry & entry) {
+                    return entry.tick <= tick;
+                }), list.entries.end());
+                list.horizon = tick;
+            }
         }
 
     protected:
-        void registerGameObject(GameObject & go) noexcept {
+        // If this throws, go is left unregistered
+        void registerGameObject(GameObject & go) {
+            if (go._enabled)
+                reserveInRegistry(go);
 			go.setManager(this);
-            for (auto & [type, comp] : go._components)
-                registerComponent(go, *comp);
-            _allEntities.unsafe.push_back(&go);
+            try {
+                // Changes made before go was registered weren't logged
+                for (const auto comp : go._slots)
+                    appendChange(comp->getComponentId(), go._handle, comp->getChangeTick());
+                if (_storage == ComponentStorage::Archetypes) {
+                    if (fitsColumns(go))
+                        moveToArchetype(go, getSignature(go._types));
+                    else
+                        makeLoose(go);
+                }
+                for (auto & [type, comp] : go._components)
+                    registerComponent(go, *comp);
+                if (go._enabled)
+                    insertInQueries(go);
+            }
+            catch (...) {
+                removeGameObject(go);
+                go.setManager(nullptr);
+                throw;
+            }
         }
 
-        void removeGameObject(const GameObject & go) noexcept {
+        void removeGameObject(GameObject & go) noexcept {
+            if (go._archetype != nullptr)
+                removeFromArchetype(go);
+            else
+                _looseEntities.erase(go);
+            eraseFromLists(go);
+        }
+
+        // go keeps its Components and its place in its archetype, it is only taken out of lists and queries
+        void disableGameObject(GameObject & go) noexcept {
+            if (!go._enabled)
+                return;
+            go._enabled = false;
+            eraseFromLists(go);
+        }
+
+        // If this throws, go is left disabled
+        void enableGameObject(GameObject & go) {
+            if (go._enabled)
+                return;
+            go._enabled = true;
+            try {
+                reserveInRegistry(go);
+                for (const auto type : go._types)
+                    insert(_entitiesByType[type], go);
+                for (const auto comp : go._slots)
+                    setInRegistry(go, *comp);
+                insertInQueries(go);
+            }
+            catch (...) {
+                eraseFromLists(go);
+                go._enabled = false;
+                throw;
+            }
+        }
+
+    private:
+        void insertInQueries(GameObject & go) {
+            insert(_allEntities, go);
+
+            // Only evaluate each query once, when encountering its first required type
+            for (const auto type : go._types)
+                for (const auto query : _queriesByType[type])
+                    if (query->required.front() == type && query->matches(go._signature))
+                        insert(*query, go);
+        }
+
+        void eraseFromLists(const GameObject & go) noexcept {
             for (const auto type : go._types)
                 removeComponent(go, type);
-			_allEntities.unsafe.erase(std::find(_allEntities.unsafe.begin(), _allEntities.unsafe.end(), &go));
+            for (const auto comp : go._slots)
+                eraseFromRegistry(go, comp->getComponentId());
+            for (const auto type : go._types)
+                for (const auto query : _queriesByType[type])
+                    if (query->required.front() == type)
+                        erase(*query, go);
+            erase(_allEntities, go);
         }
 
     private:
         friend class GameObject;
 
-        void registerComponent(GameObject & parent, const IComponent & comp) noexcept {
-            _compHierarchy.emplace(&comp, &parent);
-			_entitiesByType[comp.getType()].unsafe.push_back(&parent);
+        void registerComponent(GameObject & parent, IComponent & comp) {
+            if (parent._enabled)
+                insert(_entitiesByType[comp.getType()], parent);
+            setInRegistry(parent, comp);
         }
 
 		void removeComponent(const GameObject & go, pmeta::type_index type) noexcept {
-			auto & category = _entitiesByType[type];
-			category.unsafe.erase(std::find(category.unsafe.begin(), category.unsafe.end(), &go));
+			erase(_entitiesByType[type], go);
 		}
 
+        // Called before go or one of its Components is added to the registry, so that setInRegistry can't throw
+        void reserveInRegistry(const GameObject & go, std::size_t id) {
+            if (_registry != nullptr && _registry->contains(id))
+                _registry->reserve(go, id);
+        }
+
+        void reserveInRegistry(const GameObject & go) {
+            for (const auto comp : go._slots)
+                reserveInRegistry(go, comp->getComponentId());
+        }
+
+        // Also called by GameObject::setComponent, as Components may be moved (e.g. between archetypes)
+        void setInRegistry(GameObject & go, IComponent & comp) noexcept {
+            if (_registry != nullptr && go._enabled && _registry->contains(comp.getComponentId()))
+                _registry->set(go, comp);
+        }
+
+        void eraseFromRegistry(const GameObject & go, std::size_t id) noexcept {
+            if (_registry != nullptr && _registry->contains(id))
+                _registry->erase(go, id);
+        }
+
+        // Called once go's list of types has been updated by an attach or detach
+        void updateQueries(GameObject & go, pmeta::type_index type) {
+            if (!go._enabled) // Queries are evaluated when it is enabled again
+                return;
+
+            const auto it = _queriesByType.find(type);
+            if (it == _queriesByType.end())
+                return;
+
+            for (const auto query : it->second) {
+                if (query->matches(go._signature))
+                    insert(*query, go);
+                else
+                    erase(*query, go);
+            }
+        }
+
+        void insert(EntityCollection & collection, GameObject & go) {
+            if (collection.unsafe.insert(go))
+                markDirty(collection);
+        }
+
+        void erase(EntityCollection & collection, const GameObject & go) noexcept {
+            if (collection.unsafe.erase(go))
+                markDirty(collection);
+        }
+
+        void markDirty(EntityCollection & collection) {
+            if (collection.dirty)
+                return;
+            collection.dirty = true;
+            _dirtyCollections.push_back(&collection);
+        }
+
+        /*
+         * Archetype storage
+         */
+
+    public:
+        template<typename CT>
+        static void registerColumnType() {
+            if constexpr (std::is_move_constructible<CT>::value) {
+                static const bool registered = [] {
+                    getColumnFactories()[pmeta::type<CT>::index] = ColumnFactory{
+                            [] () -> std::unique_ptr<ComponentColumn> { return std::make_unique<TypedColumn<CT>>(); },
+                            &typeid(CT)
+                    };
+                    return true;
+                }();
+                (void)registered;
+            }
+        }
+
     private:
-        std::unordered_map<const IComponent *, const GameObject *> _compHierarchy;
+        struct ColumnFactory {
+            std::unique_ptr<ComponentColumn> (* make)();
+            const std::type_info * type; // Instances of subclasses of the Component type can't be moved into the column
+        };
+
+        static std::unordered_map<pmeta::type_index, ColumnFactory> & getColumnFactories() noexcept {
+            static std::unordered_map<pmeta::type_index, ColumnFactory> factories;
+            return factories;
+        }
+
+        // Whether comp can be stored in its archetype's column, if there is one for its type
+        static bool fitsColumn(const IComponent & comp) noexcept {
+            const auto & factories = getColumnFactories();
+            const auto it = factories.find(comp.getType());
+            return it == factories.end() || *it->second.type == typeid(comp);
+        }
+
+        static bool fitsColumns(const GameObject & go) noexcept {
+            return std::all_of(go._slots.begin(), go._slots.end(), [](const IComponent * comp) { return fitsColumn(*comp); });
+        }
+
+        // GameObjects with a Component that doesn't fit its column keep all their Components on the heap, see forEach
+        void makeLoose(GameObject & go) {
+            if (go._archetype != nullptr)
+                removeFromArchetype(go);
+            _looseEntities.insert(go);
+        }
+
+        static Archetype::Signature getSignature(const GameObject::ComponentTypes & types) {
+            Archetype::Signature ret(types.begin(), types.end());
+            std::sort(ret.begin(), ret.end());
+            return ret;
+        }
+
+        Archetype & getArchetype(const Archetype::Signature & signature) {
+            const auto it = _archetypeBySignature.find(signature);
+            if (it != _archetypeBySignature.end())
+                return *it->second;
+
+            auto archetype = std::make_unique<Archetype>(signature);
+            const auto & factories = getColumnFactories();
+            for (const auto type : signature) {
+                const auto factory = factories.find(type);
+                if (factory != factories.end())
+                    archetype->_columns.emplace(type, factory->second.make());
+            }
+
+            auto & ret = *archetype;
+            _archetypeBySignature.emplace(signature, &ret);
+            _archetypes.push_back(std::move(archetype));
+            return ret;
+        }
+
+        // Called once a Component of type has been attached (on the heap) to a GameObject that's already stored in an archetype
+        // If this throws, go and the Component haven't moved
+        IComponent & storeComponent(GameObject & go, pmeta::type_index type) {
+            moveToArchetype(go, getSignature(go._types));
+            return *go._components.at(type);
+        }
+
+        // Called when detaching type from a GameObject that's stored in an archetype
+        void unstoreComponent(GameObject & go, pmeta::type_index type) {
+            if (!go._archetype->hasType(type)) { // Attached on the heap, but never moved to its archetype, see storeComponent
+                go.disconnect(*go._components.at(type));
+                return;
+            }
+
+            if (!fitsColumns(go)) { // The archetype go moves to may have a column for one of its heap-allocated Components
+                makeLoose(go);
+                auto & comp = *go._components.at(type);
+                go.disconnect(comp);
+                eraseFromRegistry(go, comp.getComponentId()); // Added back when it was moved to the heap
+                return;
+            }
 
-		struct EntityCollection
-		{
-			std::vector<GameObject *> safe;
-			std::vector<GameObject *> unsafe;
-		};
+            if (go._archetype->_columns.find(type) == go._archetype->_columns.end())
+                go.disconnect(*go._components.at(type));
+
+            auto types = go._types;
+            types.erase(std::find(types.begin(), types.end(), type));
+            moveToArchetype(go, getSignature(types));
+        }
+
+        // Moves go (and all its Components) to the archetype for signature
+        // Everything that may throw is done before anything is moved
+        void moveToArchetype(GameObject & go, const Archetype::Signature & signature) {
+            auto & dest = getArchetype(signature);
+            reserveRow(dest);
+
+            const auto src = go._archetype;
+            const auto srcRow = go._row;
+
+            for (auto & [type, column] : dest._columns) {
+                if (src != nullptr) {
+                    const auto it = src->_columns.find(type);
+                    if (it != src->_columns.end()) {
+                        unbindComponent(go, it->second->at(srcRow));
+                        bindComponent(go, column->moveFrom(*it->second, srcRow));
+                        continue;
+                    }
+                }
+
+                // Component is currently heap-allocated
+                const auto heap = go._components.at(type);
+                unbindComponent(go, *heap);
+                bindComponent(go, column->adopt(std::move(*heap)));
+            }
+
+            if (src != nullptr) {
+                for (auto & [type, column] : src->_columns) {
+                    if (dest._columns.find(type) != dest._columns.end())
+                        continue;
+
+                    auto & comp = column->at(srcRow);
+                    unbindComponent(go, comp);
+                    if (dest.hasType(type)) { // Can't be stored contiguously in dest, move it to the heap
+                        const auto heap = column->extract(srcRow);
+                        go.setComponent(heap);
+                        go.connect(*heap);
+                    }
+                }
+                swapRemove(*src, srcRow);
+            }
+
+            go._archetype = &dest;
+            go._row = dest._entities.size();
+            dest._entities.push_back(&go);
+        }
+
+        // Moves all of go's Components back to the heap
+        void removeFromArchetype(GameObject & go) noexcept {
+            auto & archetype = *go._archetype;
+
+            for (auto & [type, column] : archetype._columns) {
+                auto & comp = column->at(go._row);
+                unbindComponent(go, comp);
+                const auto heap = column->extract(go._row);
+                go.setComponent(heap);
+                go.connect(*heap);
+            }
+
+            swapRemove(archetype, go._row);
+            go._archetype = nullptr;
+        }
+
+        // Makes sure a row can be added to archetype without the columns being re-allocated
+        void reserveRow(Archetype & archetype) {
+            if (archetype._entities.size() < archetype._capacity)
+                return;
+
+            const auto capacity = std::max<std::size_t>(archetype._capacity * 2, 16);
+            const auto & entities = archetype._entities;
+            archetype._entities.reserve(capacity);
+            for (auto & [type, column] : archetype._columns) {
+                for (std::size_t i = 0; i < column->size(); ++i)
+                    unbindComponent(*entities[i], column->at(i));
+                try {
+                    column->reserve(capacity);
+                }
+                catch (...) { // The column is left as it was
+                    for (std::size_t i = 0; i < column->size(); ++i)
+                        bindComponent(*entities[i], column->at(i));
+                    throw;
+                }
+                for (std::size_t i = 0; i < column->size(); ++i)
+                    bindComponent(*entities[i], column->at(i));
+            }
+            archetype._capacity = capacity;
+        }
+
+        // The GameObject at row must already have been unbound from its Components
+        void swapRemove(Archetype & archetype, std::size_t row) noexcept {
+            auto & entities = archetype._entities;
+            const auto last = entities.size() - 1;
+
+            for (auto & [type, column] : archetype._columns) {
+                if (row != last)
+                    unbindComponent(*entities[last], column->at(last));
+                column->swapRemove(row);
+                if (row != last)
+                    bindComponent(*entities[last], column->at(row));
+            }
+
+            if (row != last) {
+                entities[row] = entities[last];
+                entities[row]->_row = row;
+            }
+            entities.pop_back();
+        }
+
+        void bindComponent(GameObject & go, IComponent & comp) noexcept {
+            // Non-owning pointer: the archetype owns the Component
+            go.setComponent(std::shared_ptr<IComponent>(std::shared_ptr<IComponent>(), &comp));
+            go.connect(comp);
+        }
+
+        void unbindComponent(GameObject & go, IComponent & comp) noexcept {
+            go.disconnect(comp);
+            comp._owner = nullptr;
+        }
+
+    private:
+        // Nodes of an unordered_map are never moved, so pointers to its values stay valid
         std::unordered_map<pmeta::type_index, EntityCollection> _entitiesByType;
         EntityCollection _allEntities;
+        std::vector<EntityCollection *> _dirtyCollections;
+
+    private:
+        std::unordered_map<pmeta::type_index, std::unique_ptr<CachedQuery>> _queries;
+        std::unordered_map<pmeta::type_index, std::vector<CachedQuery *>> _queriesByType;
+
+    private:
+        bool _concurrentAccess = false;
+        std::mutex _listsMutex;
+
+    private:
+        ComponentStorage _storage = ComponentStorage::PerEntity;
+        std::vector<std::unique_ptr<Archetype>> _archetypes;
+        std::map<Archetype::Signature, Archetype *> _archetypeBySignature;
+        SparseSet<GameObject> _looseEntities; // Kept out of archetypes, see makeLoose
+
+    private:
+        std::unique_ptr<IComponentRegistry> _registry; // See setComponentRegistry
+
+    private:
+        std::unique_ptr<ChangeList[]> _changeLists = std::make_unique<ChangeList[]>(ComponentSignature::SIZE); // Indexed by Component id
     };
-}
\ No newline at end of file
+}
+
+inline void kengine::detail::logChange(const IComponent & comp, std::size_t componentId, std::uint64_t tick) noexcept {
+    ComponentManager::logChange(comp, componentId, tick);
+}
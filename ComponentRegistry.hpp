@@ -0,0 +1,227 @@
+#pragma once
+
+#include <array>
+#include <tuple>
+#include <vector>
+#include <limits>
+#include <cstdint>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#include "IComponentRegistry.hpp"
+#include "GameObject.hpp"
+
+namespace kengine {
+    // Contiguous arrays of the enabled GameObjects with a T and of their Ts, indexed by EntityHandle through a sparse array
+    // The Ts themselves are still owned by their GameObject (or archetype), the pool only points to them
+    template<typename T>
+    class ComponentPool {
+    public:
+        std::size_t size() const noexcept { return _entities.size(); }
+        bool empty() const noexcept { return _entities.empty(); }
+
+        // Indexed alike, in no particular order
+        GameObject * const * getGameObjects() const noexcept { return _entities.data(); }
+        T * const * getComponents() const noexcept { return _components.data(); }
+
+        // nullptr if go has no T, or is disabled
+        T * find(const GameObject & go) const noexcept {
+            const auto pos = getPosition(go);
+            return pos != NONE ? _components[pos] : nullptr;
+        }
+
+        bool contains(const GameObject & go) const noexcept { return getPosition(go) != NONE; }
+
+    private:
+        template<typename ...Components>
+        friend class ComponentRegistry;
+
+        static constexpr auto NONE = std::numeric_limits<std::uint32_t>::max();
+
+        std::uint32_t getPosition(const GameObject & go) const noexcept {
+            const auto index = go.getHandle().index;
+            if (index >= _sparse.size())
+                return NONE;
+            const auto pos = _sparse[index];
+            return pos < _entities.size() && _entities[pos] == &go ? pos : NONE;
+        }
+
+        // Allocates what set will need to add go, so that it can't throw
+        void reserve(const GameObject & go) {
+            if (contains(go))
+                return;
+
+            const auto index = go.getHandle().index;
+            if (index >= _sparse.size())
+                _sparse.resize(index + 1, NONE);
+            if (_entities.size() == _entities.capacity() || _components.size() == _components.capacity()) {
+                const auto capacity = std::max<std::size_t>(_entities.size() * 2, 16);
+                _entities.reserve(capacity);
+                _components.reserve(capacity);
+            }
+        }
+
+        // Must follow a call to reserve for go, with no other GameObject added in between
+        void set(GameObject & go, T & comp) noexcept {
+            const auto pos = getPosition(go);
+            if (pos != NONE) {
+                _components[pos] = &comp;
+                return;
+            }
+
+            _sparse[go.getHandle().index] = (std::uint32_t)_entities.size();
+            _entities.push_back(&go);
+            _components.push_back(&comp);
+        }
+
+        // Moves the last element into go's place
+        void erase(const GameObject & go) noexcept {
+            const auto pos = getPosition(go);
+            if (pos == NONE)
+                return;
+
+            _entities[pos] = _entities.back();
+            _components[pos] = _components.back();
+            _sparse[_entities[pos]->getHandle().index] = pos;
+            _entities.pop_back();
+            _components.pop_back();
+        }
+
+    private:
+        std::vector<GameObject *> _entities;
+        std::vector<T *> _components;
+        std::vector<std::uint32_t> _sparse; // Position in the dense arrays, indexed by EntityHandle::index
+    };
+
+    // Opt-in list of Component types known at compile time, see ComponentManager::setComponentRegistry
+    // Each type gets a constexpr id and a ComponentPool, so that iterating over them doesn't involve any hashing or virtual call
+    // Other Component types (e.g. from plugins) still work, and are only reached through the ComponentManager
+    template<typename ...Components>
+    class ComponentRegistry : public IComponentRegistry {
+        static_assert(std::conjunction<kengine::is_component<Components>...>::value,
+                      "Attempt to register something that's not a component");
+
+    public:
+        using types = std::tuple<Components...>;
+
+        ComponentRegistry() {
+            std::size_t index = 0;
+            for (const auto id : { detail::componentId<Components>()... }) {
+                if (id >= _indexById.size())
+                    _indexById.resize(id + 1, NONE);
+                _indexById[id] = index++;
+                if (id < ComponentSignature::SIZE)
+                    _ids.set(id);
+            }
+        }
+
+    public:
+        template<typename T>
+        static constexpr bool isRegistered() noexcept {
+            return std::disjunction<std::is_same<std::remove_const_t<T>, Components>...>::value;
+        }
+
+        // Position of T in Components
+        template<typename T>
+        static constexpr std::size_t id() noexcept {
+            static_assert(isRegistered<T>(), "Attempt to get the id of a Component type that isn't registered");
+            constexpr bool matches[] = { std::is_same<std::remove_const_t<T>, Components>::value... };
+            std::size_t ret = 0;
+            while (!matches[ret])
+                ++ret;
+            return ret;
+        }
+
+        template<typename T>
+        ComponentPool<std::remove_const_t<T>> & getPool() noexcept { return std::get<id<T>()>(_pools); }
+
+        template<typename T>
+        const ComponentPool<std::remove_const_t<T>> & getPool() const noexcept { return std::get<id<T>()>(_pools); }
+
+        // nullptr if go has no T, or is disabled. Doesn't mark the Component as changed
+        template<typename T>
+        T * find(const GameObject & go) const noexcept { return getPool<T>().find(go); }
+
+        // Calls func(GameObject &, Ts &...) for each enabled GameObject with all of Ts, walking the arrays of the smallest pool
+        // Non-const Ts are marked as changed, as with ComponentManager::forEach
+        // func must not attach or detach Components of the registered types
+        template<typename ...Ts, typename Func>
+        void forEach(Func && func) {
+            static_assert(sizeof...(Ts) > 0, "forEach called without component type");
+            static_assert(std::conjunction<std::bool_constant<isRegistered<Ts>()>...>::value,
+                          "forEach called with a Component type that isn't registered");
+
+            const std::array<std::size_t, sizeof...(Ts)> sizes{ getPool<Ts>().size()... };
+            const auto smallest = (std::size_t)(std::min_element(sizes.begin(), sizes.end()) - sizes.begin());
+            forEachFrom<Ts...>(smallest, func, std::index_sequence_for<Ts...>());
+        }
+
+    private:
+        template<typename ...Ts, typename Func, std::size_t ...Is>
+        void forEachFrom(std::size_t smallest, Func & func, std::index_sequence<Is...>) {
+            (void)((smallest == Is && (walk<std::tuple_element_t<Is, std::tuple<Ts...>>, Ts...>(func), true)) || ...);
+        }
+
+        template<typename Lead, typename ...Ts, typename Func>
+        void walk(Func & func) {
+            using LeadType = std::remove_const_t<Lead>;
+            const auto & pool = getPool<Lead>();
+            const auto entities = pool.getGameObjects();
+            const auto leads = pool.getComponents();
+            for (std::size_t i = 0; i < pool.size(); ++i) {
+                auto & go = *entities[i];
+                // The lead pool is read in order, only the others go through their sparse arrays
+                const std::tuple<std::remove_const_t<Ts> *...> components{
+                        find<std::remove_const_t<Ts>, LeadType>(go, leads[i])...
+                };
+                if (((std::get<std::remove_const_t<Ts> *>(components) != nullptr) && ...))
+                    func(go, get<Ts>(*std::get<std::remove_const_t<Ts> *>(components))...);
+            }
+        }
+
+        template<typename T, typename LeadType>
+        T * find(const GameObject & go, LeadType * lead) const noexcept {
+            if constexpr (std::is_same<T, LeadType>::value)
+                return lead;
+            else
+                return getPool<T>().find(go);
+        }
+
+        template<typename T>
+        static T & get(std::remove_const_t<T> & comp) noexcept {
+            if constexpr (!std::is_const<T>::value)
+                comp.markChanged();
+            return comp;
+        }
+
+    private:
+        static constexpr auto NONE = std::numeric_limits<std::size_t>::max();
+
+        void reserve(const GameObject & go, std::size_t componentId) final {
+            static constexpr std::array<void (*)(ComponentRegistry &, const GameObject &), sizeof...(Components)> reservers{
+                    [](ComponentRegistry & r, const GameObject & go) { std::get<ComponentPool<Components>>(r._pools).reserve(go); }...
+            };
+            reservers[_indexById[componentId]](*this, go);
+        }
+
+        void set(GameObject & go, IComponent & comp) noexcept final {
+            static constexpr std::array<void (*)(ComponentRegistry &, GameObject &, IComponent &) noexcept, sizeof...(Components)> setters{
+                    [](ComponentRegistry & r, GameObject & go, IComponent & comp) noexcept {
+                        std::get<ComponentPool<Components>>(r._pools).set(go, static_cast<Components &>(comp));
+                    }...
+            };
+            setters[_indexById[comp.getComponentId()]](*this, go, comp);
+        }
+
+        void erase(const GameObject & go, std::size_t componentId) noexcept final {
+            static constexpr std::array<void (*)(ComponentRegistry &, const GameObject &), sizeof...(Components)> erasers{
+                    [](ComponentRegistry & r, const GameObject & go) { std::get<ComponentPool<Components>>(r._pools).erase(go); }...
+            };
+            erasers[_indexById[componentId]](*this, go);
+        }
+
+    private:
+        std::tuple<ComponentPool<Components>...> _pools;
+        std::vector<std::size_t> _indexById; // Position in Components, indexed by dense Component id
+    };
+}
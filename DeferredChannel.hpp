@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vector>
+#include <mutex>
+#include <algorithm>
+#include "PacketDispatcher.hpp"
+#include "common/packets/Batch.hpp"
+
+namespace kengine {
+    namespace detail {
+        class IDeferredChannel {
+        public:
+            virtual ~IDeferredChannel() = default;
+
+            // Sends the packets buffered since the last call, and returns the number of batches sent
+            virtual std::size_t flush(const PacketDispatcher & dispatcher) = 0;
+
+            virtual void setThreadCount(std::size_t threads) = 0;
+
+        public:
+            // Set by the SystemManager when some Systems handle the packets one by one instead of as a Batch
+            bool sendIndividually = false;
+        };
+    }
+
+    // Buffers the Ps sent with SystemManager::sendDeferred, with one buffer per thread so that senders don't need to synchronize
+    // Threads outside of the SystemManager's ThreadPool share an extra buffer, behind a mutex
+    // Each buffer is delivered as a packets::Batch<P> by flush
+    template<typename P>
+    class DeferredChannel : public detail::IDeferredChannel {
+    public:
+        DeferredChannel(std::size_t threads) : _buffers(std::max<std::size_t>(threads, 1)) {}
+
+        // thread must be the caller's index in the SystemManager's ThreadPool
+        void push(std::size_t thread, const P & packet) { _buffers[thread].packets.push_back(packet); }
+
+        // For threads that don't run Systems (e.g. a render or loading thread), which may push concurrently with anyone
+        void pushLocked(const P & packet) {
+            std::lock_guard<std::mutex> lock(_lockedMutex);
+            _locked.push_back(packet);
+        }
+
+        std::size_t flush(const PacketDispatcher & dispatcher) final {
+            std::size_t batches = 0;
+
+            for (auto & buffer : _buffers) {
+                if (buffer.packets.empty())
+                    continue;
+                // Packets sent by the handlers go to the emptied buffer, and wait for the next flush
+                _delivering.swap(buffer.packets);
+                deliver(dispatcher);
+                ++batches;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(_lockedMutex);
+                _delivering.swap(_locked);
+            }
+            if (!_delivering.empty()) { // Delivered without holding the lock, as handlers may push more
+                deliver(dispatcher);
+                ++batches;
+            }
+
+            return batches;
+        }
+
+        // Buffers are never removed, as they may still hold packets
+        void setThreadCount(std::size_t threads) final {
+            if (threads > _buffers.size())
+                _buffers.resize(threads);
+        }
+
+    private:
+        void deliver(const PacketDispatcher & dispatcher) {
+            dispatcher.dispatch(packets::Batch<P>{ _delivering.data(), _delivering.size() });
+            if (sendIndividually)
+                for (const auto & packet : _delivering)
+                    dispatcher.dispatch(packet);
+            _delivering.clear();
+        }
+
+    private:
+        struct alignas(64) Buffer { // Avoid false sharing between threads pushing to neighbouring buffers
+            std::vector<P> packets;
+        };
+
+        std::vector<Buffer> _buffers;
+        std::mutex _lockedMutex;
+        std::vector<P> _locked; // See pushLocked
+        std::vector<P> _delivering;
+    };
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <ostream>
+#include <functional>
+#include "reflection/Reflectible.hpp"
+
+namespace kengine {
+    // Identifies a GameObject. Handles to removed GameObjects are detected as stale by the EntityManager,
+    // as the slot's generation is incremented whenever its GameObject is destroyed
+    struct EntityHandle {
+        static constexpr std::uint32_t INVALID_INDEX = std::numeric_limits<std::uint32_t>::max();
+
+        std::uint32_t index = INVALID_INDEX;
+        std::uint32_t generation = 0;
+
+        bool isValid() const noexcept { return index != INVALID_INDEX; }
+
+        std::uint64_t getId() const noexcept { return ((std::uint64_t)generation << 32) | index; }
+        static EntityHandle fromId(std::uint64_t id) noexcept {
+            return { (std::uint32_t)(id & 0xffffffff), (std::uint32_t)(id >> 32) };
+        }
+
+        bool operator==(const EntityHandle & rhs) const noexcept { return index == rhs.index && generation == rhs.generation; }
+        bool operator!=(const EntityHandle & rhs) const noexcept { return !(*this == rhs); }
+
+        friend std::ostream & operator<<(std::ostream & s, const EntityHandle & handle) {
+            s << '#' << handle.index << ':' << handle.generation;
+            return s;
+        }
+
+        /*
+         * Reflectible
+         */
+
+        pmeta_get_class_name(EntityHandle);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&EntityHandle::index),
+                pmeta_reflectible_attribute(&EntityHandle::generation)
+        );
+        pmeta_get_methods(
+                pmeta_reflectible_attribute(&EntityHandle::isValid),
+                pmeta_reflectible_attribute(&EntityHandle::getId)
+        );
+        pmeta_get_parents();
+    };
+}
+
+namespace std {
+    template<>
+    struct hash<kengine::EntityHandle> {
+        size_t operator()(const kengine::EntityHandle & handle) const noexcept {
+            return std::hash<std::uint64_t>()(handle.getId());
+        }
+    };
+}
@@ -1,16 +1,36 @@
 #pragma once
 
 #include <unordered_set>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <optional>
+#include <future>
+#include <thread>
+#include <chrono>
 #include <string_view>
 #include <string>
 #include <unordered_map>
 #include <memory>
 #include <type_traits>
+#include <stdexcept>
+#include <algorithm>
 #include "SystemManager.hpp"
 #include "ComponentManager.hpp"
 #include "EntityFactory.hpp"
+#include "Snapshot.hpp"
+#include "TransformHierarchy.hpp"
+#include "common/packets/SaveCompleted.hpp"
+#include "common/packets/LoadCompleted.hpp"
+#include "common/packets/MemoryReport.hpp"
 
 namespace kengine {
+    enum class SaveFormat {
+        Binary, // See Snapshot.md
+        Json // Human-readable, for debugging
+    };
+
     class EntityManager : public SystemManager, public ComponentManager {
     public:
         EntityManager(std::unique_ptr<EntityFactory> && factory = std::make_unique<ExtensibleFactory>())
@@ -26,16 +46,12 @@ namespace kengine {
             if (postCreate != nullptr)
                 postCreate(*e);
 
-            return addEntity(name, std::move(e));
+            return addEntity(std::move(e));
         }
 
+        // Creates a nameless entity, which can only be found through its EntityHandle
         GameObject & createEntity(const std::string & type, const std::function<void(GameObject &)> & postCreate = nullptr) {
-            const auto it = _ids.find(type);
-            if (it == _ids.end()) {
-                _ids.emplace(type, 0);
-                return createEntity(type, putils::concat(type, 0), postCreate);
-            }
-            return createEntity(type, putils::concat(type, ++it->second), postCreate);
+            return createEntity(type, "", postCreate);
         }
 
         template<class GO, typename ...Params>
@@ -50,58 +66,132 @@ namespace kengine {
             if (postCreate != nullptr)
                 postCreate(static_cast<GameObject &>(*entity));
 
-            return static_cast<GO &>(addEntity(name, std::move(entity)));
+            return static_cast<GO &>(addEntity(std::move(entity)));
         }
 
+        // Creates a nameless entity, which can only be found through its EntityHandle
         template<typename GO, typename ...Params>
         GO & createEntity(const std::function<void(GameObject &)> & postCreate = nullptr, Params && ...params) {
-            static_assert(putils::is_reflectible<GO>::value, "createEntity must be given an explicit name if the type parameter is not reflectible.");
+            return createEntity<GO>("", postCreate, FWD(params)...);
+        }
 
-            const auto type = GO::get_class_name();
-            const auto it = _ids.find(type);
-            if (it == _ids.end()) {
-                _ids.emplace(type, 0);
-                return createEntity<GO>(putils::concat(type, 0), postCreate, FWD(params)...);
+        // Creates count nameless copies of prototype, which needn't be managed by this EntityManager
+        // prototype's Components must be copy-constructible. postCreate is called on each copy
+        // The copies are registered with Systems through a single RegisterGameObjects packet
+        std::vector<EntityHandle> createEntities(const GameObject & prototype, std::size_t count,
+                                                 const std::function<void(GameObject &)> & postCreate = nullptr) {
+            const auto newSlots = count - std::min(count, _freeSlots.size());
+            _slots.reserve(_slots.size() + newSlots);
+            _toAdd.reserve(_toAdd.size() + count);
+            auto & pool = *getPoolForSize(sizeof(GameObject));
+            pool.reserve(pool.getUsedBlocks() + count);
+
+            std::vector<EntityHandle> ret;
+            ret.reserve(count);
+            for (std::size_t i = 0; i < count; ++i) {
+                auto go = std::make_unique<GameObject>();
+                if (prototype.hasMessaging())
+                    go->enableMessaging();
+                go->_types.reserve(prototype._types.size());
+                go->_components.reserve(prototype._types.size());
+                go->_slots.reserve(prototype._types.size());
+                for (const auto type : prototype._types)
+                    prototype._components.at(type)->attachCopyTo(*go);
+
+                if (postCreate != nullptr)
+                    postCreate(*go);
+
+                ret.push_back(addEntity(std::move(go)).getHandle());
             }
-            return createEntity<GO>(putils::concat(type, ++it->second), postCreate, FWD(params)...);
+            return ret;
         }
 
     private:
-        GameObject & addEntity(const std::string & name, std::unique_ptr<GameObject> && obj) {
+        GameObject & addEntity(std::unique_ptr<GameObject> && obj) {
             auto & ret = *obj;
-			_toAdd.push_back(std::move(obj));
-			_futureEntities[name] = &ret;
+
+            std::uint32_t index;
+            if (!_freeSlots.empty()) {
+                index = _freeSlots.back();
+                _freeSlots.pop_back();
+            }
+            else {
+                index = (std::uint32_t)_slots.size();
+                _slots.emplace_back();
+            }
+
+            auto & slot = _slots[index];
+            slot.go = std::move(obj);
+            ret._handle = { index, slot.generation };
+            _toAdd.push_back(ret._handle);
+
+            const auto & name = ret.getName();
+            if (!name.empty()) {
+                const auto it = _names.find(name);
+                if (it != _names.end()) { // Replace the previous entity with that name
+                    if (hasEntity(it->second))
+                        removeEntity(it->second);
+                    it->second = ret._handle;
+                }
+                else
+                    _names.emplace(name, ret._handle);
+            }
+
+            wakeUpFromOtherThread();
             return ret;
         }
 
     public:
-        void removeEntity(kengine::GameObject & go) noexcept {
-            _toRemove.insert(&go);
+        void removeEntity(kengine::GameObject & go) { removeEntity(go.getHandle()); }
+
+        // Threads that don't run Systems go through a CommandBuffer, which wakes the EntityManager up
+        void removeEntity(EntityHandle handle) {
+            if (!isSystemThread())
+                getCommandBuffer().removeEntity(handle);
+            else if (hasEntity(handle))
+                _toRemove.push_back(handle);
         }
 
-        void removeEntity(const std::string & name) noexcept {
-            const auto p = _entities.find(name);
-            if (p == _entities.end())
-                return;
-            _toRemove.insert(p->second.get());
+        void removeEntity(const std::string & name) {
+            const auto it = _names.find(name);
+            if (it != _names.end())
+                removeEntity(it->second);
         }
 
 	public:
-		GameObject & getEntity(const std::string & name) {
-			const auto it = _futureEntities.find(name);
-			if (it != _futureEntities.end())
-				return *it->second;
-			return *_entities.at(name);
-		}
+        // Throws std::out_of_range if handle is stale
+        GameObject & getEntity(EntityHandle handle) {
+            if (!hasEntity(handle))
+                throw std::out_of_range("[kengine] Stale entity handle");
+            return *_slots[handle.index].go;
+        }
+
+		GameObject & getEntity(const std::string & name) { return getEntity(_names.at(name)); }
 
-        bool hasEntity(const std::string & name) const noexcept { return _entities.find(name) != _entities.end(); }
+        bool hasEntity(EntityHandle handle) const noexcept {
+            return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation &&
+                   _slots[handle.index].go != nullptr;
+        }
+
+        bool hasEntity(const std::string & name) const noexcept {
+            const auto it = _names.find(name);
+            return it != _names.end() && hasEntity(it->second);
+        }
 
     public:
-        void addLink(const GameObject & parent, const GameObject & child) { _entityHierarchy[&child] = &parent; }
+        // child's TransformComponent3d then follows parent's, see TransformHierarchy
+        // Throws std::logic_error if child is parent or one of its ancestors
+        void addLink(const GameObject & parent, const GameObject & child) {
+            _hierarchy.addLink(getEntity(parent.getHandle()), getEntity(child.getHandle()));
+        }
+
+        void removeLink(const GameObject & child) { _hierarchy.removeLink(child); }
 
-        void removeLink(const GameObject & child) { _entityHierarchy.erase(&child); }
+        // Throws std::out_of_range if go has no parent
+        const GameObject & getParent(const GameObject & go) const { return _hierarchy.getParent(go); }
 
-        const GameObject & getParent(const GameObject & go) const { return *_entityHierarchy.at(&go); }
+        TransformHierarchy & getTransformHierarchy() noexcept { return _hierarchy; }
+        const TransformHierarchy & getTransformHierarchy() const noexcept { return _hierarchy; }
 
     public:
         template<typename T>
@@ -111,52 +201,160 @@ namespace kengine {
         const T & getFactory() const { return static_cast<const T &>(*_factory); }
 
     public:
+        // Types not handled by RegisterWith or by the factory are skipped, without throwing
         template<typename RegisterWith, typename ...Types>
         void registerTypes() {
-            if constexpr (!std::is_same<RegisterWith, nullptr_t>::value) {
-                try {
-                    auto & s = getSystem<RegisterWith>();
-                    s.template registerTypes<Types...>();
-                }
-                catch (const std::out_of_range &) {}
-            }
-
-			try {
-				auto & factory = getFactory<kengine::ExtensibleFactory>();
-				pmeta_for_each(Types, [this pmeta_comma &factory](auto && t) {
-					using Type = pmeta_wrapped(t);
-					if constexpr (std::is_base_of<kengine::GameObject, Type>::value)
-						factory.registerType<Type>();
-					else if constexpr (kengine::is_component<Type>::value)
-						registerCompLoader<Type>();
-				});
-			}
-			catch (const std::out_of_range &) {}
+            if constexpr (!std::is_same<RegisterWith, nullptr_t>::value)
+                if (hasSystem<RegisterWith>())
+                    getSystem<RegisterWith>().template registerTypes<Types...>();
+
+			const auto factory = dynamic_cast<kengine::ExtensibleFactory *>(_factory.get());
+			pmeta_for_each(Types, [this pmeta_comma factory](auto && t) {
+				using Type = pmeta_wrapped(t);
+				if constexpr (std::is_base_of<kengine::GameObject, Type>::value) {
+					if (factory != nullptr)
+						factory->registerType<Type>();
+				}
+				else if constexpr (kengine::is_component<Type>::value)
+					registerCompLoader<Type>();
+			});
 		}
 
+    public:
+        // Also registers the Registry's Component types to be loaded, see ComponentManager::setComponentRegistry
+        template<typename Registry>
+        Registry & setComponentRegistry() {
+            auto & ret = ComponentManager::setComponentRegistry<Registry>();
+            registerCompLoaders((typename Registry::types *)nullptr);
+            return ret;
+        }
+
+    private:
+        template<typename ...Ts>
+        void registerCompLoaders(std::tuple<Ts...> *) { (registerCompLoader<Ts>(), ...); }
+
     public:
         void execute(const std::function<void()> & betweenSystems = []{}) noexcept {
+            execute(betweenSystems, [](ISystem & s, std::size_t) { s.execute(); });
+        }
+
+    protected:
+        // See SystemManager::execute
+        template<typename RunSystem>
+        void execute(const std::function<void()> & betweenSystems, RunSystem && run) noexcept {
+			if (isSleepingWhenIdle() && _toAdd.empty() && _toRemove.empty() && _toDisable.empty() && !_justLoaded && _commandBuffers.empty())
+				waitForNextSystem();
+
+			setConcurrentAccess(getThreadCount() > 1);
 			updateEntities();
             SystemManager::execute([this, &betweenSystems] {
 				updateEntities();
                 betweenSystems();
+            }, run);
+
+            sendMemoryReport();
+        }
+
+    public:
+        using SystemManager::parallelFor;
+
+        // Calls func(GameObject &) for each GameObject in entities, splitting them in chunks spread over all threads
+        template<typename Func>
+        void parallelFor(const std::vector<GameObject *> & entities, std::size_t chunkSize, Func && func) {
+            SystemManager::parallelFor(entities.size(), chunkSize, [&entities, &func](std::size_t begin, std::size_t end) {
+                for (auto i = begin; i < end; ++i)
+                    func(*entities[i]);
+            });
+        }
+
+        // Calls func(GameObject &, Components &...) for each GameObject in view, splitting them in chunks spread over all threads
+        template<typename Func, typename ...Required>
+        void parallelFor(const QueryView<Required...> & view, std::size_t chunkSize, Func && func) {
+            parallelFor(view.getGameObjects(), chunkSize, [&func](GameObject & go) {
+                func(go, detail::getRequired<Required>(go)...);
             });
         }
 
+        // Calls func(T & result, GameObject &, Components &...) for each GameObject in view, with one result per chunk
+        // Each chunk's result starts as a copy of init, and they are then merged into init with merge(T & into, T && chunkResult)
+        // Chunks are merged in order, so the result doesn't depend on scheduling
+        template<typename T, typename Func, typename Merge, typename ...Required>
+        T parallelReduce(const QueryView<Required...> & view, std::size_t chunkSize, T init, Func && func, Merge && merge) {
+            const auto & entities = view.getGameObjects();
+            chunkSize = std::max<std::size_t>(chunkSize, 1);
+
+            std::vector<T> results((entities.size() + chunkSize - 1) / chunkSize, init);
+            SystemManager::parallelFor(entities.size(), chunkSize, [&](std::size_t begin, std::size_t end) {
+                auto & result = results[begin / chunkSize];
+                for (auto i = begin; i < end; ++i)
+                    func(result, *entities[i], detail::getRequired<Required>(*entities[i])...);
+            });
+
+            for (auto & result : results)
+                merge(init, std::move(result));
+            return init;
+        }
+
     public:
-		bool isEntityEnabled(GameObject & go) noexcept { return _disabled.find(&go) == _disabled.end(); }
-		bool isEntityEnabled(const std::string & name) noexcept { return isEntityEnabled(getEntity(name)); }
+        // Returns the calling thread's CommandBuffer, used to create, remove, enable or disable GameObjects and to attach
+        // or detach Components from any of the SystemManager's threads. Commands are played back at the next sync point,
+        // sorted by the System and parallelFor chunk that recorded them, so their order doesn't depend on scheduling
+        CommandBuffer getCommandBuffer() noexcept {
+            return CommandBuffer(_commandBuffers, isSystemThread() ? getThreadIndex() : detail::CommandBuffers::LOCKED);
+        }
 
-		void disableEntity(GameObject & go) noexcept {
-			_toDisable.emplace(&go);
+    public:
+        // Memory used by all GameObjects (enabled or not), their Components, and the Systems
+        // Walks every Component, so it is meant for periodic reports rather than for every frame
+        MemoryStats getMemoryStats() const {
+            MemoryStats ret;
+            std::unordered_map<pmeta::type_index, std::size_t> indexes; // Position in ret.components
+            for (const auto & slot : _slots)
+                if (slot.go != nullptr)
+                    addMemoryStats(*slot.go, ret, indexes);
+            sortMemoryStats(ret);
+            ret.systems = getSystemMemoryStats();
+            return ret;
+        }
+
+        // Memory used by go and its Components
+        MemoryStats getMemoryStats(const GameObject & go) const {
+            MemoryStats ret;
+            std::unordered_map<pmeta::type_index, std::size_t> indexes;
+            addMemoryStats(go, ret, indexes);
+            sortMemoryStats(ret);
+            return ret;
+        }
+
+        // Sends a packets::MemoryReport containing the result of getMemoryStats() every interval. A zero interval disables reports
+        void setMemoryReportInterval(putils::Timer::t_duration interval) noexcept {
+            _memoryReportTimer.setDuration(interval);
+            _memoryReportTimer.restart();
+        }
+
+    public:
+		bool isEntityEnabled(const GameObject & go) const noexcept { return go.isEnabled(); }
+		bool isEntityEnabled(const std::string & name) { return isEntityEnabled(getEntity(name)); }
+
+		// go keeps its Components and stays registered with Systems, which receive a DisableGameObject packet,
+		// but is skipped by getGameObjects and forEach from the next sync point on
+		// Threads that don't run Systems go through a CommandBuffer, which wakes the EntityManager up
+		void disableEntity(GameObject & go) {
+			if (!isSystemThread())
+				getCommandBuffer().disableEntity(go.getHandle());
+			else
+				_toDisable.emplace(&go);
 		}
 
 		void disableEntity(const std::string & name) { disableEntity(getEntity(name)); }
 
-		void enableEntity(GameObject & go) noexcept {
-			ComponentManager::registerGameObject(go);
-			SystemManager::registerGameObject(go);
-			_disabled.erase(&go);
+		// Throws if go couldn't be added back to lists and queries, in which case it stays disabled
+		void enableEntity(GameObject & go) {
+			_toDisable.erase(&go);
+			if (go.isEnabled())
+				return;
+			ComponentManager::enableGameObject(go);
+			SystemManager::enableGameObject(go);
 		}
 
 		void enableEntity(const std::string & name) { enableEntity(getEntity(name)); }
@@ -166,55 +364,329 @@ namespace kengine {
 
 		template<typename T>
 		void registerCompLoader(const CompLoader & loader) {
+			registerColumnType<T>(); // Now rather than from a loadAsync thread
 			_loaders[T::get_class_name()] = loader;
 		}
 
 		template<typename T>
 		void registerCompLoader() {
-			if constexpr (kengine::is_component<T>::value)
+			if constexpr (kengine::is_component<T>::value) {
+				registerColumnType<T>(); // Now rather than from a loadAsync thread
 				_loaders[T::get_class_name()] = [](kengine::GameObject & go, const putils::json::Object & json) {
-				auto & comp = go.attachComponent<T>();
-				putils::parse(comp, json.value);
-			};
+					auto & comp = go.attachComponent<T>();
+					putils::parse(comp, json.value);
+				};
+				_snapshotLayouts[pmeta::type<T>::index] = snapshot::ComponentLayout::make<T>();
+			}
 		}
 
 		void onLoad(const std::function<void()> & func) {
 			_onLoad.push_back(func);
 		}
 
-		void save(const std::string & file) {
-			std::ofstream f(file, std::ofstream::trunc);
+		void save(const std::string & file, SaveFormat format = SaveFormat::Binary) {
+			writeFile(file, format == SaveFormat::Binary ? saveSnapshot() : saveJson());
+		}
 
-			if (!f)
-				return;
+		// Detects the file's format
+		void load(const std::string & file) {
+			try {
+				commitLoad(parseFile(file));
+			}
+			catch (const std::exception & e) { std::cerr << "[kengine] Failed to load '" << file << "': " << e.what() << std::endl; }
+		}
 
-			for (const auto & go : getGameObjects())
-				f << *go;
+		// Copies all GameObjects' Components, which are then serialized and written on a background thread
+		// A packets::SaveCompleted is sent once the file is written
+		void saveAsync(const std::string & file, SaveFormat format = SaveFormat::Binary) {
+			if (format == SaveFormat::Binary)
+				_pendingSaves.push_back(runAsync<bool>(file, [file, records = copySnapshotRecords()]() mutable {
+					return writeFile(file, assembleSnapshot(std::move(records)));
+				}));
+			else
+				_pendingSaves.push_back(runAsync<bool>(file, [file, entities = copyGameObjects()] {
+					return writeFile(file, toJson(entities));
+				}));
 		}
 
-		void load(const std::string & file) {
-			std::ifstream f(file);
+		// Reads and parses file, and creates its GameObjects on a background thread
+		// They are then added in a single step at the beginning of a frame, replacing all GameObjects in existence, after which
+		// the functions registered through onLoad are called and a packets::LoadCompleted is sent
+		// Component loaders mustn't be registered while a load is pending
+		void loadAsync(const std::string & file) {
+			_pendingLoads.push_back(runAsync<std::vector<std::unique_ptr<GameObject>>>(file, [this, file] { return parseFile(file); }));
+		}
+
+		bool isSaving() const noexcept { return !_pendingSaves.empty(); }
+		bool isLoading() const noexcept { return !_pendingLoads.empty(); }
+
+	public:
+		// Serializes all GameObjects in the binary snapshot format, see Snapshot.md
+		// Only Components registered with registerCompLoader<T>() are saved
+		std::vector<char> saveSnapshot() {
+			return assembleSnapshot(copySnapshotRecords());
+		}
+
+	private:
+		// The records of each saved Component type, and the entity table, before they're assembled into a snapshot
+		// Holds copies rather than references to the GameObjects, so saveAsync can assemble them on another thread
+		struct SnapshotRecords {
+			struct Block {
+				std::string name;
+				std::vector<snapshot::Field> fields;
+				std::size_t recordSize = 0;
+				std::vector<char> records;
+			};
+
+			std::unordered_map<pmeta::type_index, Block> blocks;
+			snapshot::detail::BlobWriter blob;
+			std::vector<snapshot::EntityEntry> entityTable;
+		};
+
+		SnapshotRecords copySnapshotRecords() const {
+			using namespace snapshot;
+
+			SnapshotRecords ret;
+			const auto & entities = getGameObjects();
+			ret.entityTable.reserve(entities.size());
+
+			for (EntityIndex index = 0; index < entities.size(); ++index) {
+				const auto & go = *entities[index];
+				ret.entityTable.push_back(EntityEntry{ ret.blob.add(go.getName()) });
+
+				for (const auto type : go._types) {
+					const auto layout = _snapshotLayouts.find(type);
+					if (layout == _snapshotLayouts.end())
+						continue;
+
+					auto & block = ret.blocks[type];
+					if (block.records.empty()) {
+						block.name = layout->second.name;
+						block.fields = layout->second.fields;
+						block.recordSize = layout->second.recordSize;
+					}
+
+					auto & records = block.records;
+					records.resize(records.size() + block.recordSize);
+					const auto record = records.data() + records.size() - block.recordSize;
+					std::memcpy(record, &index, sizeof(index));
+					layout->second.write(*go._components.at(type), record, ret.blob);
+				}
+			}
+
+			return ret;
+		}
+
+		// May be called from any thread
+		static std::vector<char> assembleSnapshot(SnapshotRecords && records) {
+			using namespace snapshot;
+
+			const auto & blocks = records.blocks;
+			auto & blob = records.blob;
+			const auto & entityTable = records.entityTable;
+
+			const auto append = [](std::vector<char> & dest, const void * data, std::size_t size) {
+				const auto bytes = static_cast<const char *>(data);
+				dest.insert(dest.end(), bytes, bytes + size);
+			};
+
+			Header header;
+			std::copy(std::begin(MAGIC), std::end(MAGIC), header.magic);
+			header.version = VERSION;
+			header.typeCount = blocks.size();
+			header.typesOffset = sizeof(Header);
+
+			std::vector<char> ret(sizeof(Header) + blocks.size() * sizeof(TypeEntry));
+			std::vector<TypeEntry> types;
+			for (const auto & [type, block] : blocks) {
+				TypeEntry entry;
+				entry.name = blob.add(block.name);
+
+				entry.fieldCount = block.fields.size();
+				entry.fieldsOffset = ret.size();
+				for (const auto & field : block.fields) {
+					const FieldEntry fieldEntry{ blob.add(field.name), field.offset, field.size, field.kind };
+					append(ret, &fieldEntry, sizeof(fieldEntry));
+				}
+
+				entry.recordSize = block.recordSize;
+				entry.recordCount = block.records.size() / entry.recordSize;
+				entry.recordsOffset = ret.size();
+				append(ret, block.records.data(), block.records.size());
+
+				types.push_back(entry);
+			}
+			std::memcpy(ret.data() + header.typesOffset, types.data(), types.size() * sizeof(TypeEntry));
+
+			header.entityCount = entityTable.size();
+			header.entitiesOffset = ret.size();
+			append(ret, entityTable.data(), entityTable.size() * sizeof(EntityEntry));
 
+			header.blobOffset = ret.size();
+			header.blobSize = blob.getData().size();
+			append(ret, blob.getData().data(), blob.getData().size());
+
+			std::memcpy(ret.data(), &header, sizeof(header));
+			return ret;
+		}
+
+	public:
+		// Creates the GameObjects in a snapshot, without adding them
+		// Attributes are matched by name, those whose type changed since the snapshot was saved are left default-constructed
+		// Throws std::runtime_error or std::out_of_range if the snapshot is invalid
+		std::vector<std::unique_ptr<GameObject>> parseSnapshot(const char * data, std::size_t size) const {
+			using namespace snapshot;
+
+			const auto checkRange = [size](std::uint64_t offset, std::uint64_t count, std::uint64_t elementSize) {
+				if (offset > size || (elementSize != 0 && count > (size - offset) / elementSize))
+					throw std::out_of_range("[kengine] Corrupt snapshot: section outside of the file");
+			};
+
+			checkRange(0, 1, sizeof(Header));
+			Header header;
+			std::memcpy(&header, data, sizeof(header));
+			if (!std::equal(std::begin(MAGIC), std::end(MAGIC), header.magic))
+				throw std::runtime_error("[kengine] Not a snapshot");
+			if (header.version != VERSION)
+				throw std::runtime_error("[kengine] Unsupported snapshot version");
+
+			checkRange(header.typesOffset, header.typeCount, sizeof(TypeEntry));
+			checkRange(header.entitiesOffset, header.entityCount, sizeof(EntityEntry));
+			checkRange(header.blobOffset, header.blobSize, 1);
+			const std::string_view blob(data + header.blobOffset, header.blobSize);
+
+			const auto getString = [&blob](const Span & span) { return std::string_view(snapshot::detail::getBlobData(blob, span), span.size); };
+
+			std::vector<TypeEntry> types(header.typeCount);
+			std::memcpy(types.data(), data + header.typesOffset, types.size() * sizeof(TypeEntry));
+			for (const auto & type : types) {
+				checkRange(type.fieldsOffset, type.fieldCount, sizeof(FieldEntry));
+				if (type.recordSize < sizeof(EntityIndex))
+					throw std::runtime_error("[kengine] Corrupt snapshot: invalid record size");
+				checkRange(type.recordsOffset, type.recordCount, type.recordSize);
+			}
+
+			std::vector<std::unique_ptr<GameObject>> entities;
+			entities.reserve(header.entityCount);
+			for (std::size_t i = 0; i < header.entityCount; ++i) {
+				EntityEntry entry;
+				std::memcpy(&entry, data + header.entitiesOffset + i * sizeof(EntityEntry), sizeof(entry));
+				entities.push_back(std::make_unique<GameObject>(getString(entry.name)));
+			}
+
+			for (const auto & type : types) {
+				const auto name = getString(type.name);
+				const auto layout = std::find_if(_snapshotLayouts.begin(), _snapshotLayouts.end(),
+				                                 [name](const auto & p) { return p.second.name == name; });
+				if (layout == _snapshotLayouts.end())
+					continue;
+
+				std::vector<FieldEntry> fields(type.fieldCount);
+				std::memcpy(fields.data(), data + type.fieldsOffset, fields.size() * sizeof(FieldEntry));
+
+				std::vector<std::int64_t> fieldOffsets;
+				for (const auto & field : layout->second.fields) {
+					const auto saved = std::find_if(fields.begin(), fields.end(), [&](const FieldEntry & f) {
+						return getString(f.name) == field.name && f.kind == field.kind && f.size == field.size &&
+						       (std::uint64_t)f.offset + f.size <= type.recordSize;
+					});
+					fieldOffsets.push_back(saved != fields.end() ? (std::int64_t)saved->offset : -1);
+				}
+
+				for (std::size_t i = 0; i < type.recordCount; ++i) {
+					const auto record = data + type.recordsOffset + i * type.recordSize;
+					EntityIndex index;
+					std::memcpy(&index, record, sizeof(index));
+					if (index >= entities.size())
+						throw std::out_of_range("[kengine] Corrupt snapshot: invalid entity index");
+					layout->second.read(*entities[index], record, fieldOffsets, blob);
+				}
+			}
+
+			return entities;
+		}
+
+		// Removes all GameObjects in existence and creates those in the snapshot. data may be a memory-mapped file
+		// Throws std::runtime_error or std::out_of_range if the snapshot is invalid, in which case no GameObjects are removed
+		void loadSnapshot(const char * data, std::size_t size) {
+			commitLoad(parseSnapshot(data, size));
+		}
+
+	private:
+		std::vector<char> saveJson() {
+			return toJson(getGameObjects());
+		}
+
+		// entities holds GameObject pointers. May be called from any thread if they aren't shared with it
+		template<typename Entities>
+		static std::vector<char> toJson(const Entities & entities) {
+			std::ostringstream s;
+			for (const auto & go : entities)
+				s << *go;
+			const auto str = s.str();
+			return std::vector<char>(str.begin(), str.end());
+		}
+
+		// Detached copies of all GameObjects, for saveAsync to serialize on another thread
+		// Components that aren't copyable (e.g. holding views or physics bodies) are left out
+		std::vector<std::unique_ptr<GameObject>> copyGameObjects() const {
+			const auto & entities = getGameObjects();
+			std::vector<std::unique_ptr<GameObject>> ret;
+			ret.reserve(entities.size());
+			for (const auto go : entities) {
+				auto copy = std::make_unique<GameObject>(go->getName());
+				for (const auto type : go->_types) {
+					const auto & comp = *go->_components.at(type);
+					if (comp.isCopyable())
+						comp.attachCopyTo(*copy);
+				}
+				ret.push_back(std::move(copy));
+			}
+			return ret;
+		}
+
+		static bool writeFile(const std::string & file, const std::vector<char> & data) {
+			std::ofstream f(file, std::ofstream::trunc | std::ofstream::binary);
+			f.write(data.data(), data.size());
+			return (bool)f;
+		}
+
+		// Throws std::runtime_error if file can't be opened
+		std::vector<std::unique_ptr<GameObject>> parseFile(const std::string & file) const {
+			std::ifstream f(file, std::ifstream::binary);
 			if (!f)
-				return;
+				throw std::runtime_error("[kengine] Could not open file");
+
+			char magic[sizeof(snapshot::MAGIC)] = {};
+			f.read(magic, sizeof(magic));
+			if (f && std::equal(std::begin(magic), std::end(magic), std::begin(snapshot::MAGIC))) {
+				f.seekg(0, std::ifstream::end);
+				std::vector<char> data((std::size_t)f.tellg());
+				f.seekg(0);
+				f.read(data.data(), data.size());
+				return parseSnapshot(data.data(), data.size());
+			}
 
-			try {
-				for (const auto &[name, go] : _entities)
-					removeEntity(*go);
+			f.clear();
+			f.seekg(0);
+			return parseJson(f);
+		}
 
+		std::vector<std::unique_ptr<GameObject>> parseJson(std::istream & f) const {
+			std::vector<std::unique_ptr<GameObject>> ret;
+			try {
 				while (f && !f.eof()) {
 					auto obj = putils::json::lex(f);
-					const auto & name = obj["name"].value;
-					createEntity<kengine::GameObject>(obj["name"].value, [this, &obj](kengine::GameObject & go) { loadComponents(obj, go); });
+					auto go = std::make_unique<GameObject>(obj["name"].value);
+					loadComponents(obj, *go);
+					ret.push_back(std::move(go));
 				}
 			}
-			catch (const std::exception & e) {}
-
-			_justLoaded = true;
+			catch (const std::exception & e) {} // Keep the GameObjects parsed until then
+			return ret;
 		}
 
-    private:
-		void loadComponents(const putils::json::Object & obj, kengine::GameObject & go) {
+		void loadComponents(const putils::json::Object & obj, kengine::GameObject & go) const {
 			for (const auto &[type, comp] : obj["components"].fields) {
 				const auto it = comp.fields.find("type");
 				if (it == comp.fields.end())
@@ -226,13 +698,142 @@ namespace kengine {
 			}
 		}
 
+		// Replaces all GameObjects in existence by entities
+		void commitLoad(std::vector<std::unique_ptr<GameObject>> && entities) {
+			removeAllEntities();
+			_slots.reserve(_slots.size() + entities.size());
+			_toAdd.reserve(_toAdd.size() + entities.size());
+			for (auto & go : entities)
+				addEntity(std::move(go));
+			_justLoaded = true;
+		}
+
+		void removeAllEntities() noexcept {
+			for (const auto & slot : _slots)
+				if (slot.go != nullptr)
+					removeEntity(*slot.go);
+		}
+
+		// Sends completion packets for finished saves, and commits the oldest load if it is finished
+		void updatePendingIO() {
+			for (auto it = _pendingSaves.begin(); it != _pendingSaves.end();) {
+				if (!it->isReady()) {
+					++it;
+					continue;
+				}
+				it->thread.join();
+				send(packets::SaveCompleted{ it->file, it->result.get() });
+				it = _pendingSaves.erase(it);
+			}
+
+			// Loads are committed in the order they were started
+			if (_pendingLoads.empty() || !_pendingLoads.front().isReady())
+				return;
+
+			auto & load = _pendingLoads.front();
+			load.thread.join();
+			try {
+				commitLoad(load.result.get());
+				_loadCompleted = load.file;
+			}
+			catch (const std::exception & e) {
+				std::cerr << "[kengine] Failed to load '" << load.file << "': " << e.what() << std::endl;
+				send(packets::LoadCompleted{ load.file, false });
+			}
+			_pendingLoads.erase(_pendingLoads.begin());
+		}
+
+	private:
+		template<typename T>
+		struct PendingIO {
+			std::string file;
+			std::future<T> result;
+			std::thread thread;
+
+			PendingIO(PendingIO &&) = default;
+			PendingIO & operator=(PendingIO &&) = default;
+			~PendingIO() {
+				if (thread.joinable())
+					thread.join();
+			}
+
+			bool isReady() const { return result.wait_for(std::chrono::seconds(0)) == std::future_status::ready; }
+		};
+
+		// Runs func on a new thread, then wakes up the main loop so the result is handled without waiting for the next System
+		template<typename T, typename Func>
+		PendingIO<T> runAsync(const std::string & file, Func && func) {
+			std::promise<T> promise;
+			auto result = promise.get_future();
+			std::thread thread([this, promise = std::move(promise), func = FWD(func)]() mutable {
+				try {
+					promise.set_value(func());
+				}
+				catch (...) {
+					promise.set_exception(std::current_exception());
+				}
+				wakeUp();
+			});
+			return PendingIO<T>{ file, std::move(result), std::move(thread) };
+		}
+
+    private:
+        // GameObjects are counted as plain GameObjects, whatever their dynamic type
+        static void addMemoryStats(const GameObject & go, MemoryStats & stats,
+                                   std::unordered_map<pmeta::type_index, std::size_t> & indexes) {
+            auto & objects = stats.gameObjects;
+            ++objects.count;
+            objects.objectBytes += sizeof(GameObject);
+            if (go.hasMessaging())
+                objects.mediatorBytes += sizeof(putils::Mediator);
+
+            MemoryUsage name;
+            detail::addHeapUsage(go._name, name);
+            objects.nameBytes += name.heapBytes;
+
+            using ComponentMap = std::decay_t<decltype(go._components)>;
+            objects.componentMapBytes += go._components.bucket_count() * sizeof(void *) +
+                                         go._components.size() * (sizeof(void *) + sizeof(typename ComponentMap::value_type)) +
+                                         go._slots.capacity() * sizeof(IComponent *);
+            objects.typesBytes += go._types.capacity() * sizeof(pmeta::type_index);
+
+            for (const auto & [type, comp] : go._components) {
+                const auto it = indexes.emplace(type, stats.components.size());
+                if (it.second)
+                    stats.components.push_back(ComponentMemoryStats{ comp->getName(), type, 0, MemoryUsage{} });
+                auto & component = stats.components[it.first->second];
+                ++component.count;
+                component.usage += comp->getMemoryUsage();
+            }
+        }
+
+        static void sortMemoryStats(MemoryStats & stats) {
+            std::sort(stats.components.begin(), stats.components.end(), [](const auto & lhs, const auto & rhs) {
+                return lhs.usage.objectBytes + lhs.usage.heapBytes > rhs.usage.objectBytes + rhs.usage.heapBytes;
+            });
+        }
+
+        void sendMemoryReport() noexcept {
+            if (_memoryReportTimer.getDuration() <= putils::Timer::t_duration::zero() || !_memoryReportTimer.isDone())
+                return;
+            _memoryReportTimer.restart();
+            try {
+                send(packets::MemoryReport{ getMemoryStats() });
+            }
+            catch (const std::exception & e) { std::cerr << e.what() << std::endl; }
+        }
+
     private:
 		void updateEntities() noexcept {
+			pruneChanges(getOldestRunTick());
+			updatePendingIO();
+			playCommands();
 			doRemove();
 			updateEntitiesByType();
 			doAdd();
 			doDisable();
 			updateEntitiesByType();
+			_hierarchy.update();
 
 			if (_justLoaded) {
 				for (const auto & func : _onLoad) {
@@ -242,45 +843,102 @@ namespace kengine {
 					catch (const std::exception & e) { std::cerr << e.what() << std::endl; }
 				}
 				_justLoaded = false;
+
+				if (_loadCompleted) {
+					send(packets::LoadCompleted{ *_loadCompleted, true });
+					_loadCompleted = std::nullopt;
+				}
 			}
 
 			updateEntitiesByType();
 		}
 
 	private:
-		void doAdd() noexcept {
-			for (auto && go : _toAdd) {
-				const auto name = go->getName();
-				const auto it = _entities.find(name);
-				if (it != _entities.end()) {
-					ComponentManager::removeGameObject(*it->second);
-					SystemManager::removeGameObject(*it->second);
+		void playCommands() noexcept {
+			using Type = detail::Command::Type;
+
+			for (auto & command : _commandBuffers.take()) {
+				try {
+					if (command.type == Type::Create) {
+						createEntity<GameObject>(command.name, command.func);
+						continue;
+					}
+
+					if (!hasEntity(command.handle))
+						continue;
+					auto & go = *_slots[command.handle.index].go;
+
+					switch (command.type) {
+						case Type::Remove: removeEntity(go); break;
+						case Type::Attach: command.func(go); break;
+						case Type::Detach: go.detachComponent(command.component); break;
+						case Type::Enable: enableEntity(go); break;
+						case Type::Disable: disableEntity(go); break;
+						default: break;
+					}
 				}
-				auto & obj = *go;
-				_entities[name] = std::move(go);
+				catch (const std::exception & e) { std::cerr << e.what() << std::endl; }
+			}
+		}
+
+	private:
+		void doAdd() noexcept {
+			for (const auto handle : _toAdd) {
+				if (!hasEntity(handle)) // Removed before it was ever added
+					continue;
 
-				SystemManager::registerGameObject(obj);
-				ComponentManager::registerGameObject(obj);
+				auto & slot = _slots[handle.index];
+				try {
+					ComponentManager::registerGameObject(*slot.go);
+					slot.registered = true;
+					_adding.push_back(slot.go.get());
+				}
+				catch (const std::exception & e) { // Left unregistered, the entity is dropped
+					std::cerr << e.what() << std::endl;
+					if (slot.registered) {
+						slot.registered = false;
+						ComponentManager::removeGameObject(*slot.go);
+					}
+					removeEntity(handle);
+				}
 			}
 			_toAdd.clear();
-			_futureEntities.clear();
+
+			SystemManager::registerGameObjects(_adding);
+			_adding.clear();
 		}
 
         void doRemove() noexcept {
             while (!_toRemove.empty()) {
-                const auto tmp = _toRemove;
-                _toRemove.clear();
-
-                for (const auto go : tmp) {
-                    SystemManager::removeGameObject(*go);
-                    ComponentManager::removeGameObject(*go);
-					const auto it = _entities.find(go->getName());
-					if (it != _entities.end())
-						_entities.erase(it);
+                std::swap(_removing, _toRemove);
+
+                // Handles, rather than pointers, let entities removed twice be skipped once their slot is freed
+                for (const auto handle : _removing) {
+                    if (!hasEntity(handle))
+                        continue;
+
+                    auto & slot = _slots[handle.index];
+                    const auto go = slot.go.get();
+                    if (slot.registered) {
+                        SystemManager::removeGameObject(*go);
+                        ComponentManager::removeGameObject(*go);
+                    }
+
+                    const auto & name = go->getName();
+                    if (!name.empty()) {
+                        const auto it = _names.find(name);
+                        if (it != _names.end() && it->second == handle)
+                            _names.erase(it);
+                    }
+
+                    _toDisable.erase(go);
+                    _hierarchy.removeGameObject(*go);
+                    slot.go = nullptr;
+                    slot.registered = false;
+                    ++slot.generation;
+                    _freeSlots.push_back(handle.index);
                 }
-
-                for (const auto go : tmp)
-                    _toRemove.erase(go);
+                _removing.clear();
             }
         }
 
@@ -291,9 +949,10 @@ namespace kengine {
 				_toDisable.clear();
 
 				for (const auto go : tmp) {
-					SystemManager::removeGameObject(*go);
-					ComponentManager::removeGameObject(*go);
-					_disabled.emplace(go);
+					if (!go->isEnabled())
+						continue;
+					ComponentManager::disableGameObject(*go);
+					SystemManager::disableGameObject(*go);
 				}
 
 				for (const auto go : tmp)
@@ -303,25 +962,40 @@ namespace kengine {
 
 	private:
 		std::unordered_map<std::string, CompLoader> _loaders;
+		std::unordered_map<pmeta::type_index, snapshot::ComponentLayout> _snapshotLayouts;
 		std::vector<std::function<void()>> _onLoad;
 		bool _justLoaded = false;
 
     private:
         std::unique_ptr<EntityFactory> _factory;
-        std::unordered_map<std::string, std::size_t> _ids;
 
     private:
-        std::unordered_map<std::string, std::unique_ptr<GameObject>> _entities;
+        struct Slot {
+            std::unique_ptr<GameObject> go = nullptr;
+            std::uint32_t generation = 0;
+            bool registered = false;
+        };
+        std::vector<Slot> _slots; // Indexed by EntityHandle::index
+        std::vector<std::uint32_t> _freeSlots;
 
-        std::vector<std::unique_ptr<GameObject>> _toAdd;
-        std::unordered_map<std::string, GameObject *> _futureEntities;
+        // Optional names, used by scripts and save files
+        std::unordered_map<std::string, EntityHandle> _names;
 
-        std::unordered_set<GameObject *> _toRemove;
+        std::vector<EntityHandle> _toAdd;
+        std::vector<EntityHandle> _toRemove;
+        std::vector<EntityHandle> _removing; // Kept to reuse its capacity
+        std::vector<GameObject *> _adding; // Kept to reuse its capacity
 
-        std::unordered_map<const GameObject *, const GameObject *> _entityHierarchy;
+        TransformHierarchy _hierarchy;
+        putils::Timer _memoryReportTimer;
 
     private:
         std::unordered_set<GameObject *> _toDisable;
-        std::unordered_set<GameObject *> _disabled;
+
+	private:
+		// Declared last so that background threads are joined before the loaders they use are destroyed
+		std::vector<PendingIO<bool>> _pendingSaves;
+		std::vector<PendingIO<std::vector<std::unique_ptr<GameObject>>>> _pendingLoads;
+		std::optional<std::string> _loadCompleted; // File of the asynchronous load to report after calling onLoad functions
     };
 }
@@ -2,11 +2,15 @@
 
 #include <string>
 #include <string_view>
+#include <stdexcept>
 #include <unordered_map>
 #include <algorithm>
 #include <memory>
+#include <type_traits>
 
 #include "IComponent.hpp"
+#include "EntityHandle.hpp"
+#include "Pool.hpp"
 #include "Mediator.hpp"
 
 #include "reflection/Serializable.hpp"
@@ -18,16 +22,26 @@
 
 namespace kengine {
     class ComponentManager;
+    class Archetype;
+    class TransformHierarchy;
 
-    class GameObject : public putils::Mediator,
-                       public putils::Reflectible<GameObject>,
+    class GameObject : public putils::Reflectible<GameObject>,
                        public putils::Serializable<GameObject> {
     public:
         GameObject(std::string_view name = "") : _name(name) {}
 
         GameObject(GameObject && other) = default;
         GameObject & operator=(GameObject && other) = default;
-        ~GameObject() = default;
+        // Subclasses (e.g. KinematicObject) are deleted through GameObject pointers, and with their own size (see operator delete)
+        virtual ~GameObject() = default;
+
+    public:
+        // GameObjects are allocated from pools shared by objects of the same size
+        static void * operator new(std::size_t size) { return poolAllocate(size); }
+        static void operator delete(void * p, std::size_t size) noexcept { poolDeallocate(p, size); }
+
+        static void * operator new(std::size_t, void * where) noexcept { return where; }
+        static void operator delete(void *, void *) noexcept {}
 
     public:
         template<typename CT>
@@ -47,18 +61,23 @@ namespace kengine {
         }
 
     public:
+        // Marks the Component as changed, use the const overload to read it without doing so
+        // Throws std::out_of_range if there is no CT
         template<class CT>
         CT & getComponent() {
-            static_assert(std::is_base_of<IComponent, CT>::value,
-                          "Attempt to get something that's not a component");
-            return static_cast<CT &>(*_components.at(pmeta::type<CT>::index));
+            auto & ret = const_cast<CT &>(static_cast<const GameObject &>(*this).getComponent<CT>());
+            ret.markChanged();
+            return ret;
         };
 
         template<class CT>
         const CT & getComponent() const {
             static_assert(std::is_base_of<IComponent, CT>::value,
                           "Attempt to get something that's not a component");
-            return static_cast<const CT &>(*_components.at(pmeta::type<CT>::index));
+            const auto id = detail::componentId<CT>();
+            if (!hasComponent(id))
+                throw std::out_of_range("[kengine] Attempt to get a Component the GameObject doesn't have");
+            return static_cast<const CT &>(*_slots[_signature.rank(id)]);
         };
 
     public:
@@ -66,25 +85,111 @@ namespace kengine {
         bool hasComponent() const noexcept {
             static_assert(std::is_base_of<IComponent, CT>::value,
                           "Attempt to get something that's not a component");
-            return _components.find(pmeta::type<CT>::index) != _components.end();
+            return hasComponent(detail::componentId<CT>());
         }
 
+        // Contains the dense ids of the GameObject's Components, see IComponent::getComponentId
+        const ComponentSignature & getSignature() const noexcept { return _signature; }
+
     public:
+        // Entity-local messaging is opt-in: a GameObject only creates a putils::Mediator for its Components
+        // when this is called, or when a Component handling DataPackets is attached
+        void enableMessaging() {
+            if (_mediator != nullptr)
+                return;
+            _mediator = std::make_unique<putils::Mediator>();
+            for (const auto comp : _slots)
+                _mediator->addModule(*comp);
+        }
+
+        bool hasMessaging() const noexcept { return _mediator != nullptr; }
+
+        // Enables messaging if needed, for code that used the GameObject as a putils::Mediator
+        putils::Mediator & getMediator() {
+            enableMessaging();
+            return *_mediator;
+        }
+
+        // Sends packet to the GameObject's Components. Does nothing if messaging isn't enabled, as none of them handle packets
+        template<typename Packet>
+        void send(const Packet & packet) {
+            if (_mediator != nullptr)
+                _mediator->send(packet);
+        }
+
+    public:
+        // Empty for GameObjects created without a name
         const std::string & getName() const { return _name; }
-        const std::vector<pmeta::type_index> & getTypes() const { return _types; }
+        EntityHandle getHandle() const noexcept { return _handle; }
+        using ComponentTypes = std::vector<pmeta::type_index, PoolAllocator<pmeta::type_index>>;
+        const ComponentTypes & getTypes() const { return _types; }
+        // Disabled GameObjects keep their Components but are skipped by queries, see EntityManager::disableEntity
+        bool isEnabled() const noexcept { return _enabled; }
 
     private:
         friend class ComponentManager;
+        friend class EntityManager;
+        friend class TransformHierarchy;
+
+        EntityHandle _handle;
+        bool _enabled = true;
 
         ComponentManager * _manager = nullptr;
         void setManager(ComponentManager * manager) {
             _manager = manager;
         }
 
+        // Set by the TransformHierarchy while the GameObject is a parent or a child, to be told when its transform changes
+        TransformHierarchy * _hierarchy = nullptr;
+
+        // Set when the ComponentManager uses ComponentStorage::Archetypes
+        Archetype * _archetype = nullptr;
+        std::size_t _row = 0;
+
+        void detachComponent(pmeta::type_index type);
+
+        bool hasComponent(std::size_t id) const noexcept { return _signature.test(id); }
+
+        // comp must already be stored, see setComponent
+        void connect(IComponent & comp) {
+            if (_mediator != nullptr)
+                _mediator->addModule(comp);
+            else if (comp.handlesPackets())
+                enableMessaging();
+        }
+
+        void disconnect(IComponent & comp) noexcept {
+            if (_mediator != nullptr)
+                _mediator->removeModule(comp);
+        }
+
+        // Adds comp, or replaces the Component of the same type
+        void setComponent(std::shared_ptr<IComponent> comp);
+
+        // Makes room for one more element without letting push_back or insert throw
+        template<typename Vector>
+        static void reserveOne(Vector & v) {
+            if (v.size() == v.capacity())
+                v.reserve(std::max<std::size_t>(v.size() * 2, 4));
+        }
+
+        // id is passed in as the Component may already have been destroyed by its archetype
+        void eraseComponent(pmeta::type_index type, std::size_t id) noexcept {
+            _slots.erase(_slots.begin() + _signature.rank(id));
+            _signature.reset(id);
+            _components.erase(type);
+        }
+
     private:
         std::string _name;
-        std::unordered_map<pmeta::type_index, std::shared_ptr<IComponent>> _components;
-        std::vector<pmeta::type_index> _types;
+        std::unique_ptr<putils::Mediator> _mediator; // Heap-allocated, so Components keep a valid pointer when the GameObject is moved
+        // Owns the Components. Lookups go through _signature and _slots instead
+        std::unordered_map<pmeta::type_index, std::shared_ptr<IComponent>,
+                std::hash<pmeta::type_index>, std::equal_to<pmeta::type_index>,
+                PoolAllocator<std::pair<const pmeta::type_index, std::shared_ptr<IComponent>>>> _components;
+        ComponentTypes _types;
+        ComponentSignature _signature;
+        std::vector<IComponent *, PoolAllocator<IComponent *>> _slots; // Sorted by Component id
 
         /*
          * Reflectible
@@ -102,40 +207,71 @@ namespace kengine {
                 pmeta_reflectible_attribute(&GameObject::getName)
         );
 
-        pmeta_get_parents(
-                pmeta_reflectible_parent(putils::Mediator)
-        );
+        pmeta_get_parents();
     };
+
+    static_assert(std::has_virtual_destructor<GameObject>::value, "GameObjects are deleted through GameObject pointers");
 }
 
 #include "ComponentManager.hpp"
 
-template<typename CT>
-void kengine::GameObject::detachComponent() {
-    static_assert(std::is_base_of<IComponent, CT>::value,
-                  "Attempt to detach something that's not a component");
+inline void kengine::GameObject::setComponent(std::shared_ptr<IComponent> comp) {
+    const auto id = comp->getComponentId();
+    // Allocations come first, so that nothing is modified if they throw
+    if (!_signature.test(id))
+        reserveOne(_slots);
+    auto & owner = _components[comp->getType()];
+
+    const auto slot = _slots.begin() + _signature.rank(id);
+    if (_signature.test(id))
+        *slot = comp.get();
+    else {
+        _slots.insert(slot, comp.get());
+        _signature.set(id);
+    }
+    comp->_owner = this;
+    if (_manager)
+        _manager->setInRegistry(*this, *comp);
+    owner = std::move(comp);
+}
 
-    const auto type = pmeta::type<CT>::index;
+inline void kengine::GameObject::detachComponent(pmeta::type_index type) {
+    const auto it = _components.find(type);
+    if (it == _components.end())
+        return;
 
-    if (_manager)
+    const auto id = it->second->getComponentId();
+    if (_manager) {
         _manager->removeComponent(*this, type);
+        _manager->eraseFromRegistry(*this, id);
+    }
 
-    _components.erase(type);
+    if (_archetype != nullptr)
+        _manager->unstoreComponent(*this, type);
+    else
+        disconnect(*it->second);
+
+    eraseComponent(type, id);
     _types.erase(std::find(_types.begin(), _types.end(), type));
+
+    if (_manager)
+        _manager->updateQueries(*this, type);
 }
 
 template<typename CT>
-void kengine::GameObject::detachComponent(const CT & comp) {
+void kengine::GameObject::detachComponent() {
     static_assert(std::is_base_of<IComponent, CT>::value,
                   "Attempt to detach something that's not a component");
 
-    const auto type = comp.getType();
+    detachComponent(pmeta::type<CT>::index);
+}
 
-    if (_manager)
-        _manager->removeComponent(*this, type);
+template<typename CT>
+void kengine::GameObject::detachComponent(const CT & comp) {
+    static_assert(std::is_base_of<IComponent, CT>::value,
+                  "Attempt to detach something that's not a component");
 
-    _components.erase(type);
-    _types.erase(std::find(_types.begin(), _types.end(), type));
+    detachComponent(comp.getType());
 }
 
 template<typename CT>
@@ -143,22 +279,44 @@ CT & kengine::GameObject::attachComponent(std::unique_ptr<CT> && comp) {
     static_assert(std::is_base_of<IComponent, CT>::value,
                   "Attempt to attach something that's not a component");
 
-    auto & ret = *comp;
+    if (comp->getComponentId() >= KENGINE_MAX_COMPONENT_TYPES)
+        throw std::out_of_range("[kengine] Too many Component types, define KENGINE_MAX_COMPONENT_TYPES to a larger value");
 
-    addModule(*comp);
-    const auto type = comp->getType();
-	const auto it = _components.find(type);
-	if (it != _components.end()) {
-		_types.erase(std::find(_types.begin(), _types.end(), type));
-		if (_manager)
-			_manager->removeComponent(*this, type);
-	}
-    _components[type] = std::move(comp);
-    _types.push_back(type);
+    ComponentManager::registerColumnType<CT>();
 
+    const auto type = comp->getType();
+    reserveOne(_types);
     if (_manager)
-        _manager->registerComponent(*this, ret);
+        _manager->reserveInRegistry(*this, comp->getComponentId());
 
-    return ret;
-}
+    // Decided before anything is modified, as a column could only hold a sliced copy of a Component of a subclass
+    if (_archetype != nullptr && (!ComponentManager::fitsColumn(*comp) || !ComponentManager::fitsColumns(*this)))
+        _manager->makeLoose(*this);
 
+    detachComponent(type);
+    _types.push_back(type);
+
+    IComponent * ret = comp.get();
+    try {
+        // Allocate the control block from a pool rather than letting shared_ptr call the global allocator
+        setComponent(std::shared_ptr<IComponent>(comp.release(), std::default_delete<CT>(), PoolAllocator<CT>()));
+        connect(*ret);
+        if (_archetype != nullptr)
+            ret = &_manager->storeComponent(*this, type);
+
+        ret->markChanged();
+        if (_manager) {
+            _manager->registerComponent(*this, *ret);
+            _manager->updateQueries(*this, type);
+        }
+    }
+    catch (...) { // Leave the GameObject as if comp had never been attached
+        if (_components.find(type) != _components.end())
+            detachComponent(type);
+        else
+            _types.pop_back();
+        throw;
+    }
+
+    return static_cast<CT &>(*ret);
+}
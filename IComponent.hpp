@@ -4,14 +4,72 @@
 
 #pragma once
 
+#include <cstdint>
+#include <atomic>
 #include "meta/type.hpp"
 #include "Module.hpp"
+#include "MemoryStats.hpp"
+#include "TypeIds.hpp"
 
 namespace kengine {
+    class GameObject;
+    class IComponent;
+
+    namespace detail {
+        // Advanced by the SystemManager before and after each System executes
+        inline std::atomic<std::uint64_t> & changeTickCounter() noexcept {
+            static std::atomic<std::uint64_t> tick{ 1 };
+            return tick;
+        }
+
+        struct SystemTicks {
+            std::uint64_t current = 0; // Tick at which the System started executing
+            std::uint64_t lastRun = 0; // Tick at which it started executing the previous time
+        };
+
+        // Ticks of the System executing on this thread, zero outside of Systems
+        inline SystemTicks & currentSystemTicks() noexcept {
+            static thread_local SystemTicks ticks;
+            return ticks;
+        }
+
+        // Changes made by a System are stamped with the tick at which it started, so it doesn't see them the next time it runs
+        inline std::uint64_t getChangeTick() noexcept {
+            const auto current = currentSystemTicks().current;
+            return current != 0 ? current : changeTickCounter().load(std::memory_order_relaxed);
+        }
+
+        // Highest change tick of any Component of type T, so that Changed<T> can skip types which didn't change
+        template<typename T>
+        std::atomic<std::uint64_t> & typeChangeTick() noexcept {
+            static std::atomic<std::uint64_t> tick{ 0 };
+            return tick;
+        }
+
+        // Called when a Component of type T gets a new change tick, e.g. so the TransformHierarchy knows which GameObjects moved
+        // May be called from any of the SystemManager's threads
+        template<typename T>
+        std::atomic<void (*)(IComponent &)> & changeListener() noexcept {
+            static std::atomic<void (*)(IComponent &)> listener{ nullptr };
+            return listener;
+        }
+
+        // Adds comp's GameObject to its ComponentManager's list of changes for componentId, see ComponentManager::filterChanged
+        // Defined in ComponentManager.hpp
+        inline void logChange(const IComponent & comp, std::size_t componentId, std::uint64_t tick) noexcept;
+    }
+
     class IComponent : public virtual putils::BaseModule {
     public:
+        IComponent() = default;
         virtual ~IComponent() = default;
 
+        IComponent(const IComponent & other) noexcept : putils::BaseModule(), _changeTick(other.getChangeTick()) {}
+        IComponent & operator=(const IComponent & other) noexcept {
+            _changeTick.store(other.getChangeTick(), std::memory_order_relaxed);
+            return *this;
+        }
+
         friend std::ostream & operator<<(std::ostream & s, const kengine::IComponent & obj) {
             s << obj.toString();
             return s;
@@ -22,6 +80,46 @@ namespace kengine {
 
     public:
         virtual pmeta::type_index getType() const noexcept = 0;
+        // Reflected class name of the Component's type, used in MemoryStats
+        virtual const char * getName() const noexcept = 0;
+        // Dense id of the Component's type, see GameObject::getSignature
+        virtual std::size_t getComponentId() const noexcept = 0;
+
+        // Whether the Component's type declares DataPackets, in which case its GameObject enables messaging
+        virtual bool handlesPackets() const noexcept = 0;
+
+        // Attaches a copy of this to go, used by EntityManager::createEntities
+        virtual void attachCopyTo(GameObject & go) const = 0;
+        // Whether attachCopyTo can be called, i.e. the Component's type is copy-constructible
+        virtual bool isCopyable() const noexcept = 0;
+
+        // Implemented by Component, see EntityManager::getMemoryStats
+        virtual MemoryUsage getMemoryUsage() const noexcept = 0;
+
+    public:
+        // Called when getting the Component through a non-const GameObject, see Changed<T>
+        // Atomic, as Systems which only read the Component may still get it through a non-const GameObject
+        void markChanged() noexcept {
+            const auto tick = detail::getChangeTick();
+            if (_changeTick.load(std::memory_order_relaxed) != tick) {
+                _changeTick.store(tick, std::memory_order_relaxed);
+                markTypeChanged(tick);
+            }
+        }
+
+        std::uint64_t getChangeTick() const noexcept { return _changeTick.load(std::memory_order_relaxed); }
+
+    private:
+        // Implemented by Component, to bump detail::typeChangeTick
+        virtual void markTypeChanged(std::uint64_t tick) noexcept = 0;
+
+    private:
+        friend class GameObject;
+        friend class ComponentManager;
+        friend class TransformHierarchy;
+
+        std::atomic<std::uint64_t> _changeTick{ 0 }; // Set when attached to a GameObject
+        GameObject * _owner = nullptr; // Set by GameObject when the Component is attached, not copied
     };
 
     template<typename T>
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include "TypeIds.hpp"
+
+namespace kengine {
+    class GameObject;
+    class IComponent;
+
+    // Type-erased side of a ComponentRegistry, through which the ComponentManager keeps it up to date
+    class IComponentRegistry {
+    public:
+        virtual ~IComponentRegistry() = default;
+
+    public:
+        // Whether the Component type with this dense id (see IComponent::getComponentId) is part of the registry
+        bool contains(std::size_t componentId) const noexcept { return _ids.test(componentId); }
+
+        // Makes room for go in the pool for this Component type, so that set can't throw. The type must be part of the registry
+        virtual void reserve(const GameObject & go, std::size_t componentId) = 0;
+        // Adds comp to its pool, or updates its address if go is already there. Room must have been made for go, see reserve
+        virtual void set(GameObject & go, IComponent & comp) noexcept = 0;
+        virtual void erase(const GameObject & go, std::size_t componentId) noexcept = 0;
+
+    protected:
+        ComponentSignature _ids;
+    };
+}
@@ -10,8 +10,13 @@
 #include "GameObject.hpp"
 #include "Module.hpp"
 #include "Timer.hpp"
+#include "SystemStats.hpp"
+#include "MemoryStats.hpp"
 
 namespace kengine {
+    class SystemManager;
+    class PacketDispatcher;
+
     class ISystem : public virtual putils::BaseModule {
     protected:
         ISystem() = default;
@@ -49,6 +54,76 @@ namespace kengine {
 
     public:
         virtual pmeta::type_index getType() const noexcept = 0;
+        // Reflected class name of the System's type, or its demangled name, used in SystemStats and MemoryStats
+        virtual const char * getName() const noexcept = 0;
+
+        // Types of the DataPackets this system handles, filled in by System<CRTP, DataPackets...>
+        virtual std::vector<pmeta::type_index> getHandledPackets() const noexcept { return {}; }
+
+        // Implemented by System, which only knows the System's size
+        // Systems owning heap data (caches, resources...) should override it to add that data's size
+        virtual MemoryUsage getMemoryUsage() const noexcept = 0;
+
+        /*
+         * Access declarations, used by the SystemManager to run Systems concurrently
+         * Systems that don't declare anything are "exclusive", and never run alongside another System
+         */
+
+    protected:
+        template<typename ...Components>
+        void reads() noexcept { declare<Components...>(_access.reads); }
+
+        template<typename ...Components>
+        void writes() noexcept { declare<Components...>(_access.writes); }
+
+        // Packets sent (or queried) from execute()
+        template<typename ...Packets>
+        void sends() noexcept { declare<Packets...>(_access.sends); }
+
+    public:
+        struct Access {
+            bool declared = false;
+            std::vector<pmeta::type_index> reads;
+            std::vector<pmeta::type_index> writes;
+            std::vector<pmeta::type_index> sends;
+        };
+
+        const Access & getAccess() const noexcept { return _access; }
+
+        // Change tick at which execute was last called, Components changed after it are matched by Changed<T>
+        std::uint64_t getLastRunTick() const noexcept { return _ticks.lastRun; }
+
+#ifndef KENGINE_NO_STATS
+    protected:
+        // Called by System when sending packets, defined in SystemManager.hpp
+        void countPacketSent(pmeta::type_index type, const putils::BaseModule * dest) const noexcept;
+
+    private:
+        detail::StatsRecorder * _stats = nullptr; // Set by the SystemManager while stats are enabled
+        SystemManager * _statsManager = nullptr;
+#endif
+
+    private:
+        friend class SystemManager;
+        detail::SystemTicks _ticks; // Set by the SystemManager before calling execute
+        std::size_t _position = 0; // In the SystemManager's order, used to sort CommandBuffers
+
+        // Implemented by System, opens a DeferredChannel for each packets::Batch<P> it handles
+        virtual void openDeferredChannels(SystemManager & manager) const = 0;
+
+        // Implemented by System, adds a handler for each of its DataPackets
+        virtual void registerHandlers(PacketDispatcher & dispatcher) = 0;
+
+    protected:
+        const PacketDispatcher * _dispatcher = nullptr; // Set by the SystemManager when the System is added
+
+    private:
+        template<typename ...Ts>
+        void declare(std::vector<pmeta::type_index> & dest) noexcept {
+            _access.declared = true;
+            (dest.push_back(pmeta::type<Ts>::index), ...);
+        }
 
+        Access _access;
     };
 }
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <typeinfo>
+#include <type_traits>
+#ifdef __GNUG__
+# include <cxxabi.h>
+# include <cstdlib>
+#endif
+#include "meta/type.hpp"
+#include "reflection/Reflectible.hpp"
+
+namespace kengine {
+    // Memory used by a Component or a System, see IComponent::getMemoryUsage and ISystem::getMemoryUsage
+    struct MemoryUsage {
+        std::size_t objectBytes = 0; // sizeof the object itself
+        std::size_t heapBytes = 0; // Owned heap data: strings, vectors...
+        // std::functions holding a target. Their captures may live on the heap, but their size can't be measured,
+        // so Components owning large captures should add them to heapBytes by overriding getMemoryUsage
+        std::size_t functions = 0;
+
+        MemoryUsage & operator+=(const MemoryUsage & rhs) noexcept {
+            objectBytes += rhs.objectBytes;
+            heapBytes += rhs.heapBytes;
+            functions += rhs.functions;
+            return *this;
+        }
+
+        /*
+         * Reflectible
+         */
+
+        pmeta_get_class_name(MemoryUsage);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&MemoryUsage::objectBytes),
+                pmeta_reflectible_attribute(&MemoryUsage::heapBytes),
+                pmeta_reflectible_attribute(&MemoryUsage::functions)
+        );
+        pmeta_get_methods();
+        pmeta_get_parents();
+    };
+
+    // Memory used by all the Components of a given type
+    struct ComponentMemoryStats {
+        std::string name;
+        pmeta::type_index type;
+        std::size_t count = 0;
+        MemoryUsage usage;
+
+        /*
+         * Reflectible
+         */
+
+        pmeta_get_class_name(ComponentMemoryStats);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&ComponentMemoryStats::name),
+                pmeta_reflectible_attribute(&ComponentMemoryStats::count),
+                pmeta_reflectible_attribute(&ComponentMemoryStats::usage)
+        );
+        pmeta_get_methods();
+        pmeta_get_parents();
+    };
+
+    struct SystemMemoryStats {
+        std::string name;
+        pmeta::type_index type;
+        MemoryUsage usage;
+
+        /*
+         * Reflectible
+         */
+
+        pmeta_get_class_name(SystemMemoryStats);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&SystemMemoryStats::name),
+                pmeta_reflectible_attribute(&SystemMemoryStats::usage)
+        );
+        pmeta_get_methods();
+        pmeta_get_parents();
+    };
+
+    // Bookkeeping of the GameObjects themselves, excluding their Components
+    // Containers' heap usage is estimated from their capacity, node and bucket counts
+    struct GameObjectMemoryStats {
+        std::size_t count = 0;
+        std::size_t objectBytes = 0; // sizeof the GameObjects
+        std::size_t mediatorBytes = 0; // Mediators of the GameObjects with messaging enabled, see GameObject::enableMessaging
+        std::size_t nameBytes = 0; // Heap-allocated names
+        std::size_t componentMapBytes = 0; // Nodes and buckets of the Component maps, and Component slots
+        std::size_t typesBytes = 0; // Lists of Component types
+
+        std::size_t getTotal() const noexcept { return objectBytes + mediatorBytes + nameBytes + componentMapBytes + typesBytes; }
+
+        /*
+         * Reflectible
+         */
+
+        pmeta_get_class_name(GameObjectMemoryStats);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&GameObjectMemoryStats::count),
+                pmeta_reflectible_attribute(&GameObjectMemoryStats::objectBytes),
+                pmeta_reflectible_attribute(&GameObjectMemoryStats::mediatorBytes),
+                pmeta_reflectible_attribute(&GameObjectMemoryStats::nameBytes),
+                pmeta_reflectible_attribute(&GameObjectMemoryStats::componentMapBytes),
+                pmeta_reflectible_attribute(&GameObjectMemoryStats::typesBytes)
+        );
+        pmeta_get_methods();
+        pmeta_get_parents();
+    };
+
+    // See EntityManager::getMemoryStats
+    struct MemoryStats {
+        std::vector<ComponentMemoryStats> components; // Sorted by decreasing total size
+        std::vector<SystemMemoryStats> systems;
+        GameObjectMemoryStats gameObjects;
+
+        std::size_t getTotal() const noexcept {
+            auto ret = gameObjects.getTotal();
+            for (const auto & c : components)
+                ret += c.usage.objectBytes + c.usage.heapBytes;
+            for (const auto & s : systems)
+                ret += s.usage.objectBytes + s.usage.heapBytes;
+            return ret;
+        }
+
+        /*
+         * Reflectible
+         */
+
+        pmeta_get_class_name(MemoryStats);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&MemoryStats::components),
+                pmeta_reflectible_attribute(&MemoryStats::systems),
+                pmeta_reflectible_attribute(&MemoryStats::gameObjects)
+        );
+        pmeta_get_methods();
+        pmeta_get_parents();
+    };
+
+    namespace detail {
+        template<typename T>
+        struct is_vector : std::false_type {};
+        template<typename T, typename A>
+        struct is_vector<std::vector<T, A>> : std::true_type {};
+
+        template<typename T>
+        struct is_std_function : std::false_type {};
+        template<typename T>
+        struct is_std_function<std::function<T>> : std::true_type {};
+
+        template<typename T, typename = void>
+        struct has_class_name : std::false_type {};
+        template<typename T>
+        struct has_class_name<T, std::void_t<decltype(T::get_class_name())>> : std::true_type {};
+
+        // Name given to T in stats, see IComponent::getName and ISystem::getName
+        // Types without a reflected class name fall back to their demangled typeid name
+        template<typename T>
+        const char * getClassName() noexcept {
+            if constexpr (has_class_name<T>::value)
+                return T::get_class_name();
+            else {
+                static const std::string name = [] {
+                    const char * mangled = typeid(T).name();
+#ifdef __GNUG__
+                    int status = 0;
+                    const auto demangled = abi::__cxa_demangle(mangled, nullptr, nullptr, &status);
+                    if (status == 0 && demangled != nullptr) {
+                        std::string ret(demangled);
+                        std::free(demangled);
+                        return ret;
+                    }
+#endif
+                    return std::string(mangled);
+                }();
+                return name.c_str();
+            }
+        }
+
+        // Adds the heap data owned by obj to usage. Reflectible types are walked through their attributes
+        template<typename T>
+        void addHeapUsage(const T & obj, MemoryUsage & usage) noexcept {
+            if constexpr (std::is_same<T, std::string>::value) {
+                static const auto localCapacity = std::string().capacity(); // Small strings are stored inline
+                if (obj.capacity() > localCapacity)
+                    usage.heapBytes += obj.capacity() + 1;
+            }
+            else if constexpr (is_vector<T>::value) {
+                usage.heapBytes += obj.capacity() * sizeof(typename T::value_type);
+                for (const auto & element : obj)
+                    addHeapUsage(element, usage);
+            }
+            else if constexpr (is_std_function<T>::value) {
+                if (obj != nullptr)
+                    ++usage.functions;
+            }
+            else if constexpr (putils::is_reflectible<T>::value) {
+                pmeta::tuple_for_each(T::get_attributes().getKeyValues(), [&obj, &usage](auto && attr) {
+                    using Member = std::decay_t<decltype(obj.*(attr.second))>;
+                    addHeapUsage<Member>(obj.*(attr.second), usage);
+                });
+            }
+        }
+    }
+}
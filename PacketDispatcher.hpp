@@ -0,0 +1,147 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include "Module.hpp"
+
+namespace kengine {
+    namespace detail {
+        inline std::size_t nextPacketIndex() noexcept {
+            static std::atomic<std::size_t> next{ 0 };
+            return next++;
+        }
+
+        // Dense index for each packet type, used to index dispatch tables
+        template<typename P>
+        std::size_t packetIndex() noexcept {
+            static const auto index = nextPacketIndex();
+            return index;
+        }
+
+        // Receives the response to a query, which handlers send back with sendTo(response, *query.sender)
+        template<typename Response>
+        class QueryResponder : public putils::Module<QueryResponder<Response>, Response> {
+        public:
+            void handle(const Response & r) { response = r; }
+            Response response;
+        };
+    }
+
+    // Routes packets sent by Systems straight to their handlers, instead of going through putils::Mediator
+    // Tables are filled from each System's DataPackets, see System::registerHandlers
+    class PacketDispatcher {
+    public:
+        struct Handler {
+            void * module;
+            void (*handle)(void * module, const void * packet);
+        };
+
+        // Calls the handlers known at compile time for a packet type, see StaticSystemManager
+        // Returns whether there were any. If firstOnly is set, only the first one is called
+        struct StaticRoute {
+            void * manager = nullptr;
+            bool (*route)(void * manager, const void * packet, bool firstOnly) = nullptr;
+        };
+
+    public:
+        template<typename P, typename Receiver>
+        void addHandler(Receiver & module) {
+            const auto index = detail::packetIndex<P>();
+            if (index >= _handlers.size())
+                _handlers.resize(index + 1);
+            _handlers[index].push_back(Handler{
+                    &module,
+                    [](void * module, const void * packet) { static_cast<Receiver *>(module)->handle(*static_cast<const P *>(packet)); }
+            });
+        }
+
+        // Modules that aren't Systems, which receive every packet and check its type themselves
+        void addModule(putils::BaseModule & module) { _modules.push_back(&module); }
+        void removeModule(putils::BaseModule & module) { _modules.erase(std::remove(_modules.begin(), _modules.end(), &module), _modules.end()); }
+        bool hasModules() const noexcept { return !_modules.empty(); }
+
+        // Static routes are called before the handlers added through addHandler, and aren't removed by clear, see clearStaticRoutes
+        template<typename P>
+        void setStaticRoute(const StaticRoute & route) {
+            const auto index = detail::packetIndex<P>();
+            if (index >= _staticRoutes.size())
+                _staticRoutes.resize(index + 1);
+            _staticRoutes[index] = route;
+        }
+
+        // Called when the Systems the static routes call into are destroyed
+        void clearStaticRoutes() noexcept { _staticRoutes.clear(); }
+
+        void clear() noexcept {
+            for (auto & handlers : _handlers)
+                handlers.clear();
+        }
+
+    public:
+        // Whether dispatching P would reach anyone. Modules that aren't Systems receive every packet
+        template<typename P>
+        bool hasReceivers() const noexcept {
+            return getStaticRoute<P>().route != nullptr || !getHandlers<P>().empty() || !_modules.empty();
+        }
+
+        template<typename P>
+        void dispatch(const P & packet) const {
+            const auto & route = getStaticRoute<P>();
+            if (route.route != nullptr)
+                route.route(route.manager, &packet, false);
+            for (const auto & handler : getHandlers<P>())
+                handler.handle(handler.module, &packet);
+            sendToModules(packet);
+        }
+
+        // Only the first handler is called, and the query is only sent to other Modules if no System handles it
+        template<typename Response, typename Query>
+        Response query(Query && q) const {
+            detail::QueryResponder<Response> responder;
+            q.sender = &responder;
+
+            const auto & route = getStaticRoute<std::decay_t<Query>>();
+            if (route.route != nullptr && route.route(route.manager, &q, true))
+                return std::move(responder.response);
+
+            const auto & handlers = getHandlers<std::decay_t<Query>>();
+            if (!handlers.empty())
+                handlers.front().handle(handlers.front().module, &q);
+            else
+                sendToModules(q);
+
+            return std::move(responder.response);
+        }
+
+    private:
+        template<typename P>
+        const std::vector<Handler> & getHandlers() const noexcept {
+            static const std::vector<Handler> none;
+            const auto index = detail::packetIndex<P>();
+            return index < _handlers.size() ? _handlers[index] : none;
+        }
+
+        template<typename P>
+        const StaticRoute & getStaticRoute() const noexcept {
+            static const StaticRoute none;
+            const auto index = detail::packetIndex<P>();
+            return index < _staticRoutes.size() ? _staticRoutes[index] : none;
+        }
+
+        template<typename P>
+        void sendToModules(const P & packet) const {
+            if (_modules.empty())
+                return;
+            const putils::DataPacket<P> dataPacket(packet);
+            for (const auto module : _modules)
+                module->receive(dataPacket);
+        }
+
+    private:
+        std::vector<std::vector<Handler>> _handlers; // Indexed by detail::packetIndex
+        std::vector<StaticRoute> _staticRoutes; // Indexed by detail::packetIndex
+        std::vector<putils::BaseModule *> _modules;
+    };
+}
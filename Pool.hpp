@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+#include <array>
+#include <mutex>
+#include <new>
+#include <algorithm>
+
+namespace kengine {
+    // Allocates fixed-size blocks from slabs, which are never given back to the system
+    // Freed blocks are reused, most recently freed first, so steady-state allocation never reaches the global allocator
+    class BlockPool {
+    public:
+        static constexpr std::size_t ALIGNMENT = alignof(std::max_align_t);
+
+        BlockPool(std::size_t blockSize) noexcept
+                : _blockSize(roundUp(std::max(blockSize, sizeof(FreeBlock)))) {}
+
+        BlockPool(const BlockPool &) = delete;
+        BlockPool & operator=(const BlockPool &) = delete;
+
+    public:
+        void * allocate() {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_free == nullptr)
+                grow();
+
+            const auto ret = _free;
+            _free = _free->next;
+            ++_used;
+            return ret;
+        }
+
+        void deallocate(void * p) noexcept {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto block = static_cast<FreeBlock *>(p);
+            block->next = _free;
+            _free = block;
+            --_used;
+        }
+
+    public:
+        std::size_t getBlockSize() const noexcept { return _blockSize; }
+        std::size_t getUsedBlocks() const noexcept { return _used; }
+        std::size_t getCapacity() const noexcept { return _capacity; }
+
+        // Makes sure count blocks can be used without allocating a new slab
+        void reserve(std::size_t count) {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (count > _capacity)
+                addSlab(count - _capacity);
+        }
+
+    private:
+        struct FreeBlock {
+            FreeBlock * next;
+        };
+
+        static std::size_t roundUp(std::size_t size) noexcept { return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+        // Slabs double in size, from FIRST_SLAB to MAX_SLAB blocks
+        static constexpr std::size_t FIRST_SLAB = 64;
+        static constexpr std::size_t MAX_SLAB = 4096;
+
+        void grow() { addSlab(std::clamp(_capacity, FIRST_SLAB, MAX_SLAB)); }
+
+        void addSlab(std::size_t count) {
+            const auto slab = static_cast<unsigned char *>(::operator new(count * _blockSize));
+            _slabs.push_back(slab);
+
+            for (std::size_t i = count; i > 0; --i) {
+                const auto block = reinterpret_cast<FreeBlock *>(slab + (i - 1) * _blockSize);
+                block->next = _free;
+                _free = block;
+            }
+            _capacity += count;
+        }
+
+    private:
+        const std::size_t _blockSize;
+        std::mutex _mutex;
+        FreeBlock * _free = nullptr;
+        std::vector<unsigned char *> _slabs;
+        std::size_t _used = 0;
+        std::size_t _capacity = 0;
+    };
+
+    // Pools are never destroyed, so that pooled objects may safely outlive static destruction
+
+    // Pool dedicated to T
+    template<typename T>
+    BlockPool & getPool() {
+        static auto & pool = *new BlockPool(sizeof(T));
+        return pool;
+    }
+
+    // Pool shared by all allocations of the same size class (multiples of BlockPool::ALIGNMENT)
+    // Returns nullptr for sizes above MAX_POOLED_SIZE
+    constexpr std::size_t MAX_POOLED_SIZE = 1024;
+
+    inline BlockPool * getPoolForSize(std::size_t size) {
+        static const auto pools = [] {
+            std::array<BlockPool *, MAX_POOLED_SIZE / BlockPool::ALIGNMENT> ret;
+            for (std::size_t i = 0; i < ret.size(); ++i)
+                ret[i] = new BlockPool((i + 1) * BlockPool::ALIGNMENT);
+            return ret;
+        }();
+
+        if (size == 0 || size > MAX_POOLED_SIZE)
+            return nullptr;
+        return pools[(size - 1) / BlockPool::ALIGNMENT];
+    }
+
+    inline void * poolAllocate(std::size_t size) {
+        if (const auto pool = getPoolForSize(size))
+            return pool->allocate();
+        return ::operator new(size);
+    }
+
+    inline void poolDeallocate(void * p, std::size_t size) noexcept {
+        if (const auto pool = getPoolForSize(size))
+            pool->deallocate(p);
+        else
+            ::operator delete(p);
+    }
+
+    // Uses T's dedicated pool if size is T's, e.g. falls back to size classes for sub-classes of T
+    template<typename T>
+    void * poolAllocate(std::size_t size) {
+        if constexpr (alignof(T) > BlockPool::ALIGNMENT)
+            return ::operator new(size, std::align_val_t{ alignof(T) });
+        else if (size == sizeof(T))
+            return getPool<T>().allocate();
+        else
+            return poolAllocate(size);
+    }
+
+    template<typename T>
+    void poolDeallocate(void * p, std::size_t size) noexcept {
+        if constexpr (alignof(T) > BlockPool::ALIGNMENT)
+            ::operator delete(p, std::align_val_t{ alignof(T) });
+        else if (size == sizeof(T))
+            getPool<T>().deallocate(p);
+        else
+            poolDeallocate(p, size);
+    }
+
+    // Standard allocator drawing from size classes, e.g. for std::shared_ptr control blocks and container nodes
+    template<typename T>
+    class PoolAllocator {
+    public:
+        using value_type = T;
+
+        PoolAllocator() noexcept = default;
+        template<typename U>
+        PoolAllocator(const PoolAllocator<U> &) noexcept {}
+
+        T * allocate(std::size_t n) {
+            if constexpr (alignof(T) > BlockPool::ALIGNMENT)
+                return static_cast<T *>(::operator new(n * sizeof(T), std::align_val_t{ alignof(T) }));
+            else
+                return static_cast<T *>(poolAllocate(n * sizeof(T)));
+        }
+
+        void deallocate(T * p, std::size_t n) noexcept {
+            if constexpr (alignof(T) > BlockPool::ALIGNMENT)
+                ::operator delete(p, std::align_val_t{ alignof(T) });
+            else
+                poolDeallocate(p, n * sizeof(T));
+        }
+
+        template<typename U>
+        bool operator==(const PoolAllocator<U> &) const noexcept { return true; }
+        template<typename U>
+        bool operator!=(const PoolAllocator<U> &) const noexcept { return false; }
+    };
+}
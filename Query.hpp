@@ -0,0 +1,209 @@
+#pragma once
+
+#include <tuple>
+#include <vector>
+#include <algorithm>
+#include <type_traits>
+#include "meta/type.hpp"
+#include "SparseSet.hpp"
+#include "TypeIds.hpp"
+
+namespace kengine {
+    class GameObject;
+
+    // Excludes GameObjects with a T from a query, e.g. getGameObjects<TransformComponent3d, Without<PhysicsComponent>>()
+    template<typename T>
+    struct Without {
+        using type = T;
+    };
+
+    // Only matches GameObjects whose T was changed since the calling System last ran, e.g. getGameObjects<Changed<TransformComponent3d>>()
+    // Components are marked as changed when attached, when obtained through a non-const GameObject, or by IComponent::markChanged
+    // Query const Ts, e.g. getGameObjects<const TransformComponent3d, GraphicsComponent>(), to read them without marking them
+    template<typename T>
+    struct Changed {
+        using type = T;
+    };
+
+    namespace detail {
+        template<typename T>
+        struct is_without : std::false_type {};
+
+        template<typename T>
+        struct is_without<Without<T>> : std::true_type {};
+
+        template<typename T>
+        struct is_changed : std::false_type {};
+
+        template<typename T>
+        struct is_changed<Changed<T>> : std::true_type {};
+
+        template<typename T>
+        struct required_type { using type = std::tuple<T>; };
+        template<typename T>
+        struct required_type<Without<T>> { using type = std::tuple<>; };
+        template<typename T>
+        struct required_type<Changed<T>> { using type = std::tuple<T>; };
+
+        template<typename T>
+        struct changed_type { using type = std::tuple<>; };
+        template<typename T>
+        struct changed_type<Changed<T>> { using type = std::tuple<std::remove_const_t<T>>; };
+
+        template<typename ...Ts>
+        using changed_types = decltype(std::tuple_cat(std::declval<typename changed_type<Ts>::type>()...));
+
+        // Type used to look up the CachedQuery: Changed<T> and const T share T's
+        template<typename T>
+        struct query_type { using type = std::remove_const_t<T>; };
+        template<typename T>
+        struct query_type<Changed<T>> { using type = std::remove_const_t<T>; };
+        template<typename T>
+        using query_type_t = typename query_type<T>::type;
+
+        // Gets a const Required without marking it as changed
+        template<typename Required>
+        Required & getRequired(GameObject & go) {
+            if constexpr (std::is_const<Required>::value)
+                return static_cast<const GameObject &>(go).template getComponent<std::remove_const_t<Required>>();
+            else
+                return go.template getComponent<Required>();
+        }
+
+        template<typename T>
+        struct excluded_type { using type = std::tuple<>; };
+        template<typename T>
+        struct excluded_type<Without<T>> { using type = std::tuple<T>; };
+
+        template<typename ...Ts>
+        using required_types = decltype(std::tuple_cat(std::declval<typename required_type<Ts>::type>()...));
+
+        template<typename ...Ts>
+        using excluded_types = decltype(std::tuple_cat(std::declval<typename excluded_type<Ts>::type>()...));
+
+        template<typename ...Ts>
+        std::vector<pmeta::type_index> getTypeIndexes(std::tuple<Ts...> *) noexcept {
+            std::vector<pmeta::type_index> ret{ pmeta::type<std::remove_const_t<Ts>>::index... };
+            std::sort(ret.begin(), ret.end());
+            return ret;
+        }
+    }
+
+    // List of GameObjects, as seen by Systems (safe) and as currently registered (unsafe)
+    // safe is only re-copied from unsafe if unsafe was modified since the last snapshot
+    struct EntityCollection {
+        std::vector<GameObject *> safe;
+        SparseSet<GameObject> unsafe;
+        bool dirty = false;
+    };
+
+    // Cached list of the GameObjects matching a query, updated whenever Components are attached or detached
+    class CachedQuery : public EntityCollection {
+    public:
+        CachedQuery(std::vector<pmeta::type_index> && required, std::vector<pmeta::type_index> && excluded)
+                : required(std::move(required)), excluded(std::move(excluded)) {
+            for (const auto type : this->required) {
+                const auto id = detail::getComponentId(type);
+                if (id < ComponentSignature::SIZE)
+                    _required.set(id);
+                else // No GameObject can have this type
+                    _matchesNothing = true;
+            }
+            for (const auto type : this->excluded) {
+                const auto id = detail::getComponentId(type);
+                if (id < ComponentSignature::SIZE)
+                    _excluded.set(id);
+            }
+        }
+
+    public:
+        // Used for GameObjects
+        bool matches(const ComponentSignature & signature) const noexcept {
+            return !_matchesNothing && signature.contains(_required) && !signature.intersects(_excluded);
+        }
+
+        // Used for archetypes, whose signatures are sorted lists of types
+        template<typename Types>
+        bool matches(const Types & types) const noexcept {
+            const auto has = [&types](pmeta::type_index type) {
+                return std::find(types.begin(), types.end(), type) != types.end();
+            };
+            return std::all_of(required.begin(), required.end(), has) &&
+                   std::none_of(excluded.begin(), excluded.end(), has);
+        }
+
+    public:
+        const std::vector<pmeta::type_index> required;
+        const std::vector<pmeta::type_index> excluded;
+
+    private:
+        ComponentSignature _required;
+        ComponentSignature _excluded;
+        bool _matchesNothing = false;
+    };
+
+    // Iterates over GameObjects, yielding an std::tuple<GameObject &, Required &...> for each of them
+    template<typename ...Required>
+    class QueryView {
+    public:
+        using value_type = std::tuple<GameObject &, Required &...>;
+
+        QueryView(const std::vector<GameObject *> & entities) noexcept : _entities(&entities) {}
+
+        // Owns a list of GameObjects filtered from a CachedQuery, e.g. for Changed<T>
+        QueryView(std::vector<GameObject *> && filtered) noexcept : _filtered(std::move(filtered)), _entities(&_filtered) {}
+
+        QueryView(const QueryView & other) : _filtered(other._filtered), _entities(other.owns() ? &_filtered : other._entities) {}
+        QueryView(QueryView && other) noexcept : _filtered(std::move(other._filtered)), _entities(other.owns() ? &_filtered : other._entities) {}
+
+        QueryView & operator=(QueryView other) noexcept {
+            const auto owned = other.owns();
+            _filtered = std::move(other._filtered);
+            _entities = owned ? &_filtered : other._entities;
+            return *this;
+        }
+
+    public:
+        class iterator {
+        public:
+            iterator(std::vector<GameObject *>::const_iterator it) noexcept : _it(it) {}
+
+            value_type operator*() const {
+                auto & go = **_it;
+                return value_type(go, detail::getRequired<Required>(go)...);
+            }
+
+            iterator & operator++() noexcept { ++_it; return *this; }
+            bool operator==(const iterator & rhs) const noexcept { return _it == rhs._it; }
+            bool operator!=(const iterator & rhs) const noexcept { return _it != rhs._it; }
+
+        private:
+            std::vector<GameObject *>::const_iterator _it;
+        };
+
+        iterator begin() const noexcept { return iterator(_entities->begin()); }
+        iterator end() const noexcept { return iterator(_entities->end()); }
+
+        std::size_t size() const noexcept { return _entities->size(); }
+        bool empty() const noexcept { return _entities->empty(); }
+
+        const std::vector<GameObject *> & getGameObjects() const noexcept { return *_entities; }
+
+    private:
+        bool owns() const noexcept { return _entities == &_filtered; }
+
+        std::vector<GameObject *> _filtered;
+        const std::vector<GameObject *> * _entities;
+    };
+
+    namespace detail {
+        template<typename Tuple>
+        struct view_type;
+
+        template<typename ...Required>
+        struct view_type<std::tuple<Required...>> { using type = QueryView<Required...>; };
+    }
+
+    template<typename ...Ts>
+    using QueryViewFor = typename detail::view_type<detail::required_types<Ts...>>::type;
+}
@@ -146,6 +146,16 @@ namespace kengine {
 					[this](const std::string & file) { _em.load(file); }
 				)
 			);
+            crtp.registerFunction("saveAsync",
+				std::function<void(const std::string &)>(
+					[this](const std::string & file) { _em.saveAsync(file); }
+				)
+			);
+            crtp.registerFunction("loadAsync",
+				std::function<void(const std::string &)>(
+					[this](const std::string & file) { _em.loadAsync(file); }
+				)
+			);
 
             crtp.registerFunction("onLoad",
 				std::function<void(const std::function<void()> &)>(
@@ -1,22 +1,101 @@
 #pragma once
 
+#include <string>
+#include <string_view>
+#include <sstream>
+#include <ostream>
+#include <iterator>
+#include <type_traits>
 #include "Component.hpp"
-#include "reflection/Serializable.hpp"
+#include "reflection/Reflectible.hpp"
 
 namespace kengine {
+    namespace detail {
+        template<typename T, typename = void>
+        struct is_streamable : std::false_type {};
+        template<typename T>
+        struct is_streamable<T, std::void_t<decltype(std::declval<std::ostream &>() << std::declval<const T &>())>> : std::true_type {};
+
+        template<typename T, typename = void>
+        struct is_iterable : std::false_type {};
+        template<typename T>
+        struct is_iterable<T, std::void_t<decltype(std::begin(std::declval<const T &>()), std::end(std::declval<const T &>()))>> : std::true_type {};
+
+        inline void writeJsonString(std::ostream & s, std::string_view str) {
+            s << '"';
+            for (const auto c : str) {
+                if (c == '"' || c == '\\')
+                    s << '\\';
+                s << c;
+            }
+            s << '"';
+        }
+
+        // Writes the reflectible attributes of obj as the fields of a JSON object, each preceded by a comma if first is false
+        template<typename T>
+        void writeJsonFields(std::ostream & s, const T & obj, bool first);
+
+        // Reflectible types are written as objects and containers as arrays. Types that can't be written (std::function...) are null
+        template<typename T>
+        void writeJson(std::ostream & s, const T & value) {
+            if constexpr (std::is_convertible<const T &, std::string_view>::value)
+                writeJsonString(s, value);
+            else if constexpr (std::is_same<T, bool>::value)
+                s << (value ? "true" : "false");
+            else if constexpr (std::is_arithmetic<T>::value)
+                s << value;
+            else if constexpr (putils::is_reflectible<T>::value) {
+                s << '{';
+                writeJsonFields(s, value, true);
+                s << '}';
+            }
+            else if constexpr (is_iterable<T>::value) {
+                s << '[';
+                bool first = true;
+                for (const auto & element : value) {
+                    if (!first)
+                        s << ',';
+                    first = false;
+                    writeJson(s, element);
+                }
+                s << ']';
+            }
+            else if constexpr (is_streamable<T>::value)
+                s << value;
+            else
+                s << "null";
+        }
+
+        template<typename T>
+        void writeJsonFields(std::ostream & s, const T & obj, bool first) {
+            pmeta::tuple_for_each(T::get_attributes().getKeyValues(), [&s, &obj, &first](auto && attr) {
+                if (!first)
+                    s << ',';
+                first = false;
+                writeJsonString(s, attr.first);
+                s << ':';
+                writeJson(s, obj.*(attr.second));
+            });
+        }
+    }
+
+    // Component whose toString writes its reflectible attributes as a JSON object
     template<typename CRTP, typename ...DataPackets>
-    class SerializableComponent : public Component<CRTP, DataPackets...>,
-                                  public putils::Serializable<CRTP> {
+    class SerializableComponent : public Component<CRTP, DataPackets...> {
     public:
-        template<typename ...MemberPairs>
-        SerializableComponent(MemberPairs && ...pairs)
-                : putils::Serializable<CRTP>(FWD(pairs)...) {}
-
-        SerializableComponent() = default;
+        // The object starts with a "type" field holding CRTP's class name, used by EntityManager::loadComponents to find its loader
+        void serialize(std::ostream & s) const {
+            s << '{';
+            detail::writeJsonString(s, "type");
+            s << ':';
+            detail::writeJsonString(s, CRTP::get_class_name());
+            detail::writeJsonFields(s, static_cast<const CRTP &>(*this), false);
+            s << '}';
+        }
 
         std::string toString() const noexcept override {
             std::stringstream s;
-            this->serialize(s);
+            serialize(s);
             return s.str();
         }
 
@@ -0,0 +1,248 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include "GameObject.hpp"
+#include "meta/type.hpp"
+
+namespace kengine {
+    // Binary save format used by EntityManager::save, see Snapshot.md for the layout
+    // All structures are stored as-is, in native byte order. Offsets are relative to the start of the file
+    namespace snapshot {
+        constexpr char MAGIC[4] = { 'K', 'S', 'N', 'P' };
+        constexpr std::uint32_t VERSION = 1;
+
+        // Bytes in the blob section
+        struct Span {
+            std::uint64_t offset;
+            std::uint64_t size;
+        };
+
+        struct Header {
+            char magic[4];
+            std::uint32_t version;
+            std::uint64_t typeCount;
+            std::uint64_t typesOffset;
+            std::uint64_t entityCount;
+            std::uint64_t entitiesOffset;
+            std::uint64_t blobOffset;
+            std::uint64_t blobSize;
+        };
+
+        // One per Component type, followed in the file by its fields and its block of records
+        struct TypeEntry {
+            Span name;
+            std::uint64_t fieldCount;
+            std::uint64_t fieldsOffset;
+            std::uint64_t recordSize;
+            std::uint64_t recordCount;
+            std::uint64_t recordsOffset;
+        };
+
+        enum class FieldKind : std::uint32_t {
+            Raw, // Trivially copyable, stored in the record
+            String, // std::string, stored in the record as a Span
+            Array, // std::vector of a trivially copyable type, stored in the record as a Span
+            StringArray // std::vector<std::string>, stored in the record as a Span over Spans
+        };
+
+        struct FieldEntry {
+            Span name;
+            std::uint32_t offset; // In the record
+            std::uint32_t size;
+            FieldKind kind;
+            std::uint32_t padding = 0;
+        };
+
+        // Records start with the index of their GameObject in the entity table
+        using EntityIndex = std::uint64_t;
+
+        struct EntityEntry {
+            Span name;
+        };
+
+        namespace detail {
+            template<typename T>
+            struct is_vector : std::false_type {};
+            template<typename T, typename A>
+            struct is_vector<std::vector<T, A>> : std::true_type {};
+
+            // Attributes which don't fit any FieldKind, e.g. std::functions, and const attributes, are skipped
+            template<typename M>
+            constexpr bool isSupported() {
+                if constexpr (std::is_const<M>::value)
+                    return false;
+                else if constexpr (std::is_same<M, std::string>::value)
+                    return true;
+                else if constexpr (is_vector<M>::value)
+                    return std::is_same<typename M::value_type, std::string>::value ||
+                           (std::is_trivially_copyable<typename M::value_type>::value &&
+                            !std::is_same<typename M::value_type, bool>::value); // std::vector<bool> has no data()
+                else
+                    return std::is_trivially_copyable<M>::value && !std::is_pointer<M>::value;
+            }
+
+            template<typename M>
+            constexpr FieldKind getKind() {
+                if constexpr (std::is_same<M, std::string>::value)
+                    return FieldKind::String;
+                else if constexpr (is_vector<M>::value) {
+                    if constexpr (std::is_same<typename M::value_type, std::string>::value)
+                        return FieldKind::StringArray;
+                    else
+                        return FieldKind::Array;
+                }
+                else
+                    return FieldKind::Raw;
+            }
+
+            template<typename M>
+            constexpr std::uint32_t getSize() {
+                if constexpr (getKind<M>() == FieldKind::Raw)
+                    return sizeof(M);
+                else
+                    return sizeof(Span);
+            }
+
+            template<typename T, typename F>
+            void forEachField(F && f) {
+                pmeta::tuple_for_each(T::get_attributes().getKeyValues(), [&f](auto && attr) {
+                    using Member = std::remove_reference_t<decltype(std::declval<T &>().*(attr.second))>;
+                    if constexpr (isSupported<Member>())
+                        f(attr.first, attr.second, (Member *)nullptr);
+                });
+            }
+
+            class BlobWriter {
+            public:
+                Span add(const void * data, std::size_t size) {
+                    const Span ret{ _data.size(), size };
+                    const auto bytes = static_cast<const char *>(data);
+                    _data.insert(_data.end(), bytes, bytes + size);
+                    return ret;
+                }
+
+                Span add(std::string_view str) { return add(str.data(), str.size()); }
+
+                const std::vector<char> & getData() const noexcept { return _data; }
+
+            private:
+                std::vector<char> _data;
+            };
+
+            template<typename M>
+            void writeField(const M & member, char * dest, BlobWriter & blob) {
+                if constexpr (getKind<M>() == FieldKind::Raw)
+                    std::memcpy(dest, &member, sizeof(M));
+                else {
+                    Span span;
+                    if constexpr (getKind<M>() == FieldKind::String)
+                        span = blob.add(member);
+                    else if constexpr (getKind<M>() == FieldKind::Array)
+                        span = blob.add(member.data(), member.size() * sizeof(typename M::value_type));
+                    else {
+                        std::vector<Span> strings;
+                        for (const auto & s : member)
+                            strings.push_back(blob.add(s));
+                        span = blob.add(strings.data(), strings.size() * sizeof(Span));
+                    }
+                    std::memcpy(dest, &span, sizeof(span));
+                }
+            }
+
+            // Throws std::out_of_range if the span isn't inside the blob
+            inline const char * getBlobData(std::string_view blob, const Span & span) {
+                if (span.offset > blob.size() || span.size > blob.size() - span.offset)
+                    throw std::out_of_range("[kengine] Corrupt snapshot: span outside of the blob");
+                return blob.data() + span.offset;
+            }
+
+            template<typename M>
+            void readField(M & member, const char * src, std::string_view blob) {
+                if constexpr (getKind<M>() == FieldKind::Raw)
+                    std::memcpy(&member, src, sizeof(M));
+                else {
+                    Span span;
+                    std::memcpy(&span, src, sizeof(span));
+                    auto data = getBlobData(blob, span);
+
+                    if constexpr (getKind<M>() == FieldKind::String)
+                        member.assign(data, span.size);
+                    else if constexpr (getKind<M>() == FieldKind::Array) {
+                        member.resize(span.size / sizeof(typename M::value_type));
+                        std::memcpy(member.data(), data, member.size() * sizeof(typename M::value_type));
+                    }
+                    else {
+                        member.resize(span.size / sizeof(Span));
+                        for (auto & s : member) {
+                            Span str;
+                            std::memcpy(&str, data, sizeof(str));
+                            data += sizeof(str);
+                            s.assign(getBlobData(blob, str), str.size);
+                        }
+                    }
+                }
+            }
+        }
+
+        struct Field {
+            std::string name;
+            std::uint32_t offset;
+            std::uint32_t size;
+            FieldKind kind;
+        };
+
+        // Describes how a Component type is stored in snapshots, generated from its reflectible attributes
+        struct ComponentLayout {
+            std::string name;
+            std::vector<Field> fields;
+            std::size_t recordSize;
+
+            // Writes comp's attributes into record, which is recordSize bytes long
+            std::function<void(const IComponent & comp, char * record, detail::BlobWriter & blob)> write;
+            // Attaches a Component to go, reading each attribute at the offset given by fieldOffsets (-1 for missing fields)
+            std::function<void(GameObject & go, const char * record, const std::vector<std::int64_t> & fieldOffsets, std::string_view blob)> read;
+
+            template<typename T>
+            static ComponentLayout make() {
+                ComponentLayout ret;
+                ret.name = T::get_class_name();
+
+                std::uint32_t offset = sizeof(EntityIndex);
+                detail::forEachField<T>([&](const auto & name, auto, auto * type) {
+                    using Member = std::remove_pointer_t<decltype(type)>;
+                    ret.fields.push_back(Field{ std::string(name), offset, detail::getSize<Member>(), detail::getKind<Member>() });
+                    offset += detail::getSize<Member>();
+                });
+                ret.recordSize = offset;
+
+                ret.write = [fields = ret.fields](const IComponent & comp, char * record, detail::BlobWriter & blob) {
+                    const auto & obj = static_cast<const T &>(comp);
+                    auto field = fields.begin();
+                    detail::forEachField<T>([&](const auto &, auto member, auto *) {
+                        detail::writeField(obj.*member, record + field->offset, blob);
+                        ++field;
+                    });
+                };
+
+                ret.read = [](GameObject & go, const char * record, const std::vector<std::int64_t> & fieldOffsets, std::string_view blob) {
+                    auto & obj = go.attachComponent<T>();
+                    auto offset = fieldOffsets.begin();
+                    detail::forEachField<T>([&](const auto &, auto member, auto *) {
+                        if (*offset >= 0)
+                            detail::readField(obj.*member, record + *offset, blob);
+                        ++offset;
+                    });
+                };
+
+                return ret;
+            }
+        };
+    }
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <stdexcept>
+#include "EntityHandle.hpp"
+
+namespace kengine {
+    // Set of T *, with O(1) insertion, removal and lookup, whose elements are stored contiguously
+    // T must provide getHandle(), returning an EntityHandle, which is used to index the sparse array
+    template<typename T>
+    class SparseSet {
+    public:
+        bool contains(const T & obj) const noexcept {
+            const auto index = obj.getHandle().index;
+            return index < _sparse.size() && _sparse[index] < _dense.size() && _dense[_sparse[index]] == &obj;
+        }
+
+        // nullptr if no element has this handle
+        T * find(EntityHandle handle) const noexcept {
+            if (handle.index >= _sparse.size() || _sparse[handle.index] >= _dense.size())
+                return nullptr;
+            const auto ret = _dense[_sparse[handle.index]];
+            return ret->getHandle() == handle ? ret : nullptr;
+        }
+
+        // Returns false if obj was already present
+        bool insert(T & obj) {
+            if (contains(obj))
+                return false;
+
+            const auto handle = obj.getHandle();
+            if (!handle.isValid())
+                throw std::invalid_argument("[kengine] Attempt to insert an object without a valid handle into a SparseSet");
+
+            if (handle.index >= _sparse.size())
+                _sparse.resize(handle.index + 1);
+            _sparse[handle.index] = (std::uint32_t)_dense.size();
+            _dense.push_back(&obj);
+            return true;
+        }
+
+        // Moves the last element into obj's place. Returns false if obj wasn't present
+        bool erase(const T & obj) noexcept {
+            if (!contains(obj))
+                return false;
+
+            const auto pos = _sparse[obj.getHandle().index];
+            const auto last = _dense.back();
+            _dense[pos] = last;
+            _sparse[last->getHandle().index] = pos;
+            _dense.pop_back();
+            return true;
+        }
+
+        void clear() noexcept { _dense.clear(); }
+
+    public:
+        const std::vector<T *> & getDense() const noexcept { return _dense; }
+
+        std::size_t size() const noexcept { return _dense.size(); }
+        bool empty() const noexcept { return _dense.empty(); }
+
+        auto begin() const noexcept { return _dense.begin(); }
+        auto end() const noexcept { return _dense.end(); }
+
+    private:
+        std::vector<T *> _dense;
+        std::vector<std::uint32_t> _sparse; // Position in _dense, indexed by EntityHandle::index
+    };
+}
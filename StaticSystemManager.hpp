@@ -0,0 +1,117 @@
+#pragma once
+
+#include <tuple>
+#include <utility>
+#include <type_traits>
+#include "EntityManager.hpp"
+
+namespace kengine {
+    namespace detail {
+        // Deduces the DataPackets of a System from its System<CRTP, DataPackets...> base
+        template<typename CRTP, typename ...DataPackets>
+        std::tuple<DataPackets...> getHandledPackets(const System<CRTP, DataPackets...> *);
+
+        template<typename S>
+        using handled_packets = decltype(getHandledPackets((const S *)nullptr));
+
+        template<typename T, typename Tuple>
+        struct tuple_contains;
+
+        template<typename T, typename ...Ts>
+        struct tuple_contains<T, std::tuple<Ts...>> : std::disjunction<std::is_same<T, Ts>...> {};
+    }
+
+    // EntityManager whose Systems are known at compile time. They are held in an std::tuple, executed in the order
+    // in which they are listed through direct calls, and receive packets through routes generated for each packet type
+    // Systems added at run-time (createSystem, loadSystems, plugins) are executed after them
+    template<typename ...Systems>
+    class StaticSystemManager : public EntityManager {
+        static_assert(std::conjunction<std::is_base_of<ISystem, Systems>...>::value,
+                      "Attempt to create a StaticSystemManager with something that's not a System");
+
+    public:
+        // Systems are constructed with the EntityManager, in order, then all added
+        StaticSystemManager(std::unique_ptr<EntityFactory> && factory = std::make_unique<ExtensibleFactory>())
+                : EntityManager(std::move(factory)), _systems(self<Systems>()...) {
+            (addStaticSystem(std::get<Systems>(_systems)), ...);
+            (addRoutes((detail::handled_packets<Systems> *)nullptr), ...);
+        }
+
+        ~StaticSystemManager() { removeStaticSystems(); }
+
+    public:
+        void execute(const std::function<void()> & betweenSystems = []{}) noexcept {
+            EntityManager::execute(betweenSystems, [this](ISystem & s, std::size_t position) {
+                if (position < sizeof...(Systems))
+                    executeStatic(position, std::index_sequence_for<Systems...>());
+                else
+                    s.execute();
+            });
+        }
+
+    public:
+        // Static Systems are returned without any lookup, others through EntityManager::getSystem
+        template<typename T>
+        T & getSystem() {
+            if constexpr (isStatic<T>())
+                return std::get<T>(_systems);
+            else
+                return EntityManager::getSystem<T>();
+        }
+
+        template<typename T>
+        const T & getSystem() const {
+            if constexpr (isStatic<T>())
+                return std::get<T>(_systems);
+            else
+                return EntityManager::getSystem<T>();
+        }
+
+        template<typename T>
+        static constexpr bool isStatic() noexcept { return std::disjunction<std::is_same<T, Systems>...>::value; }
+
+    private:
+        template<typename>
+        EntityManager & self() noexcept { return *this; }
+
+        template<std::size_t ...Is>
+        void executeStatic(std::size_t position, std::index_sequence<Is...>) {
+            (void)((position == Is && (executeStatic<Is>(), true)) || ...);
+        }
+
+        // Qualified call, so execute isn't dispatched virtually and can be inlined
+        template<std::size_t I>
+        void executeStatic() {
+            using S = std::tuple_element_t<I, std::tuple<Systems...>>;
+            std::get<I>(_systems).S::execute();
+        }
+
+    private:
+        template<typename ...Packets>
+        void addRoutes(std::tuple<Packets...> *) {
+            (setStaticRoute<Packets>(PacketDispatcher::StaticRoute{ this, &route<Packets> }), ...);
+        }
+
+        // Calls the handlers of the static Systems handling P, in order
+        template<typename P>
+        static bool route(void * manager, const void * packet, bool firstOnly) {
+            auto & em = *static_cast<StaticSystemManager *>(manager);
+            bool handled = false;
+            (em.template routeTo<Systems>(*static_cast<const P *>(packet), firstOnly, handled), ...);
+            return handled;
+        }
+
+        template<typename S, typename P>
+        void routeTo(const P & packet, bool firstOnly, bool & handled) {
+            if constexpr (detail::tuple_contains<P, detail::handled_packets<S>>::value) {
+                if (firstOnly && handled)
+                    return;
+                std::get<S>(_systems).handle(packet);
+                handled = true;
+            }
+        }
+
+    private:
+        std::tuple<Systems...> _systems;
+    };
+}
@@ -1,8 +1,12 @@
 #pragma once
 
 #include "ISystem.hpp"
+#include "PacketDispatcher.hpp"
 #include "common/packets/RegisterGameObject.hpp"
 #include "common/packets/RemoveGameObject.hpp"
+#include "common/packets/EnableGameObject.hpp"
+#include "common/packets/DisableGameObject.hpp"
+#include "common/packets/Batch.hpp"
 
 namespace kengine {
     class EntityManager;
@@ -18,5 +22,57 @@ namespace kengine {
                           "System's first template parameter should be inheriting class");
             return pmeta::type<CRTP>::index;
         }
+
+        const char * getName() const noexcept final { return detail::getClassName<CRTP>(); }
+
+        std::vector<pmeta::type_index> getHandledPackets() const noexcept final {
+            return { pmeta::type<DataPackets>::index... };
+        }
+
+        MemoryUsage getMemoryUsage() const noexcept override {
+            MemoryUsage ret;
+            ret.objectBytes = sizeof(CRTP);
+            return ret;
+        }
+
+    private:
+        // Defined in SystemManager.hpp
+        void openDeferredChannels(SystemManager & manager) const final;
+
+        void registerHandlers(PacketDispatcher & dispatcher) final {
+            (dispatcher.addHandler<DataPackets>(static_cast<CRTP &>(*this)), ...);
+        }
+
+        // Shadow putils::BaseModule's functions to go through the SystemManager's PacketDispatcher,
+        // and to count the packets sent, see SystemManager::setStatsEnabled
+    public:
+        template<typename P>
+        void send(const P & packet) const {
+#ifndef KENGINE_NO_STATS
+            countPacketSent(pmeta::type<P>::index, nullptr);
+#endif
+            if (_dispatcher != nullptr)
+                _dispatcher->dispatch(packet);
+            else
+                putils::BaseModule::send(packet);
+        }
+
+        template<typename P>
+        void sendTo(const P & packet, putils::BaseModule & dest) const {
+#ifndef KENGINE_NO_STATS
+            countPacketSent(pmeta::type<P>::index, &dest);
+#endif
+            putils::BaseModule::sendTo(packet, dest);
+        }
+
+        template<typename Response, typename Query>
+        Response query(Query && q) {
+#ifndef KENGINE_NO_STATS
+            countPacketSent(pmeta::type<std::decay_t<Query>>::index, nullptr);
+#endif
+            if (_dispatcher != nullptr)
+                return _dispatcher->template query<Response>(FWD(q));
+            return putils::BaseModule::template query<Response>(FWD(q));
+        }
     };
 }
\ No newline at end of file
@@ -4,20 +4,36 @@
 #include <cmath>
 #include <vector>
 #include <memory>
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <typeinfo>
+#include <stdexcept>
 #include "System.hpp"
 #include "GameObject.hpp"
 #include "Mediator.hpp"
 #include "pluginManager/PluginManager.hpp"
 #include "Timer.hpp"
+#include "ThreadPool.hpp"
+#include "DeferredChannel.hpp"
+#include "PacketDispatcher.hpp"
+#include "CommandBuffer.hpp"
+#include "TypeIds.hpp"
 #include "common/packets/RegisterGameObject.hpp"
+#include "common/packets/RegisterGameObjects.hpp"
 #include "common/packets/RemoveGameObject.hpp"
+#include "common/packets/EnableGameObject.hpp"
+#include "common/packets/DisableGameObject.hpp"
+#include "common/packets/StatsReport.hpp"
 
 namespace kengine {
     class EntityManager;
 
     class SystemManager : public putils::Mediator {
     public:
-        SystemManager() = default;
+        SystemManager() { _commandBuffers.onLockedPush = [this] { wakeUp(); }; }
         ~SystemManager() = default;
 
     public:
@@ -26,6 +42,14 @@ namespace kengine {
 
     public:
         void execute(const std::function<void()> & betweenSystems = []{}) noexcept {
+            execute(betweenSystems, [](ISystem & s, std::size_t) { s.execute(); });
+        }
+
+    protected:
+        // run(s, position) must call s.execute(). StaticSystemManager uses it to call its Systems without virtual dispatch
+        template<typename RunSystem>
+        void execute(const std::function<void()> & betweenSystems, RunSystem && run) noexcept {
+            _executingThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
             if (_first) {
                 _first = false;
                 resetTimers();
@@ -33,38 +57,587 @@ namespace kengine {
 
             updateSystemList();
 
-            for (auto & [type, s] : _systems) {
-                auto & time = s->time;
-                auto & timer = time.timer;
+            if (_threadPool == nullptr) {
+                for (const auto s : _order)
+                    if (isDue(*s)) {
+                        updateTime(*s);
+                        try {
+                            executeSystem(*s, run);
+                            flushDeferred();
+                            betweenSystems();
+                        }
+                        catch (const std::exception & e) { std::cerr << e.what() << std::endl; }
+                    }
+            }
+            else
+                executeBatches(betweenSystems, run);
+
+#ifndef KENGINE_NO_STATS
+            if (_statsEnabled)
+                sendStatsReport();
+#endif
+        }
+
+    private:
+        template<typename RunSystem>
+        void executeBatches(const std::function<void()> & betweenSystems, RunSystem & run) noexcept {
+            if (_scheduleDirty)
+                updateSchedule();
+
+            std::vector<ISystem *> due;
+            for (const auto & batch : _schedule) {
+                due.clear();
+                for (const auto s : batch)
+                    if (isDue(*s)) {
+                        updateTime(*s);
+                        due.push_back(s);
+                    }
+
+                if (due.empty())
+                    continue;
 
-                if (time.alwaysCall || timer.isDone()) {
-                    updateTime(*s);
+                _threadPool->forEachIndex(due.size(), [this, &due, &run](std::size_t i) {
                     try {
-                        s->execute();
-                        betweenSystems();
+                        executeSystem(*due[i], run);
                     }
                     catch (const std::exception & e) { std::cerr << e.what() << std::endl; }
+                });
+                flushDeferred();
+                betweenSystems();
+            }
+        }
+
+        template<typename RunSystem>
+        void executeSystem(ISystem & s, RunSystem & run) {
+            // Components changed after execute, even outside of Systems, must get a new tick
+            // The previous ticks and origin are restored, as this thread may have stolen s while waiting in another System's parallelFor
+            struct Ticking {
+                detail::SystemTicks & current;
+                detail::SystemTicks previous;
+                detail::CommandOrigin & origin;
+                detail::CommandOrigin previousOrigin;
+
+                ~Ticking() {
+                    current = previous;
+                    origin = previousOrigin;
+                    ++detail::changeTickCounter();
                 }
+            };
+
+            s._ticks.lastRun = s._ticks.current;
+            s._ticks.current = ++detail::changeTickCounter();
+            auto & current = detail::currentSystemTicks();
+            auto & origin = detail::currentCommandOrigin();
+            const Ticking ticking{ current, current, origin, origin };
+            current = s._ticks;
+            origin = { s._position + 1, 0, 0 };
+
+#ifndef KENGINE_NO_STATS
+            if (s._stats != nullptr) {
+                struct Recording { // Records even if execute throws
+                    detail::StatsRecorder & stats;
+                    detail::StatsRecorder * previous;
+                    putils::Timer::t_clock::time_point start;
+
+                    ~Recording() {
+                        const auto time = std::chrono::duration<double, std::milli>(putils::Timer::t_clock::now() - start);
+                        stats.record(time.count());
+                        detail::currentStatsRecorder() = previous;
+                    }
+                };
+
+                auto & currentStats = detail::currentStatsRecorder();
+                const Recording recording{ *s._stats, currentStats, putils::Timer::t_clock::now() };
+                currentStats = s._stats;
+                s._stats->entitiesVisited = 0;
+                run(s, s._position);
+                return;
+            }
+#endif
+            run(s, s._position);
+        }
+
+    public:
+        // Records execution times, packets and entities visited for each System. Has no effect if KENGINE_NO_STATS is defined
+        void setStatsEnabled(bool enabled) {
+#ifndef KENGINE_NO_STATS
+            _statsEnabled = enabled;
+            updateStatsBindings();
+#endif
+        }
+
+        bool areStatsEnabled() const noexcept { return _statsEnabled; }
+
+        // Sends a packets::StatsReport every interval while stats are enabled. A zero interval disables reports
+        void setStatsReportInterval(putils::Timer::t_duration interval) noexcept {
+            _statsReportTimer.setDuration(interval);
+            _statsReportTimer.restart();
+        }
+
+        std::vector<SystemStats> getSystemStats() const {
+            std::vector<SystemStats> ret;
+#ifndef KENGINE_NO_STATS
+            for (const auto s : _order) {
+                const auto it = _statsRecorders.find(s->getType());
+                if (it != _statsRecorders.end())
+                    ret.push_back(getSystemStats(*s, *it->second));
             }
+#endif
+            return ret;
+        }
+
+        // Unlike execution stats, memory usage is computed on demand and doesn't need stats to be enabled
+        std::vector<SystemMemoryStats> getSystemMemoryStats() const {
+            std::vector<SystemMemoryStats> ret;
+            for (const auto s : _order)
+                ret.push_back(SystemMemoryStats{ s->getName(), s->getType(), s->getMemoryUsage() });
+            return ret;
+        }
+
+        // Throws std::out_of_range if no stats were recorded for T
+        template<typename T>
+        SystemStats getSystemStats() const {
+            static_assert(std::is_base_of<ISystem, T>::value, "Attempt to get stats for something that isn't a System");
+#ifdef KENGINE_NO_STATS
+            throw std::out_of_range("[kengine] Stats are compiled out");
+#else
+            return getSystemStats(getSystem<T>(), *_statsRecorders.at(pmeta::type<T>::index));
+#endif
+        }
+
+#ifndef KENGINE_NO_STATS
+    private:
+        friend class ISystem;
+
+        static SystemStats getSystemStats(const ISystem & s, const detail::StatsRecorder & recorder) {
+            auto ret = recorder.get();
+            ret.name = s.getName();
+            ret.type = s.getType();
+            return ret;
+        }
+
+        void updateStatsBindings() {
+            _statsHandlers.clear();
+            for (const auto s : _order) {
+                if (!_statsEnabled) {
+                    s->_stats = nullptr;
+                    continue;
+                }
+
+                auto & recorder = _statsRecorders[s->getType()];
+                if (recorder == nullptr)
+                    recorder = std::make_unique<detail::StatsRecorder>();
+                s->_stats = recorder.get();
+                s->_statsManager = this;
+                for (const auto packet : s->getHandledPackets())
+                    _statsHandlers[packet].push_back(recorder.get());
+            }
+        }
+
+        void countPacketReceived(pmeta::type_index type, const putils::BaseModule * dest) noexcept {
+            if (dest != nullptr) {
+                const auto system = dynamic_cast<const ISystem *>(dest);
+                if (system != nullptr && system->_stats != nullptr)
+                    ++system->_stats->packetsReceived;
+                return;
+            }
+
+            const auto it = _statsHandlers.find(type);
+            if (it != _statsHandlers.end())
+                for (const auto recorder : it->second)
+                    ++recorder->packetsReceived;
+        }
+
+        void sendStatsReport() {
+            if (_statsReportTimer.getDuration() <= putils::Timer::t_duration::zero() || !_statsReportTimer.isDone())
+                return;
+            _statsReportTimer.restart();
+            countPacketReceived(pmeta::type<packets::StatsReport>::index, nullptr);
+            send(packets::StatsReport{ getSystemStats() });
+        }
+#endif
+
+    public:
+        // When enabled, the EntityManager sleeps until the next System is due instead of polling their timers
+        void setSleepWhenIdle(bool sleep) noexcept { _sleepWhenIdle = sleep; }
+        bool isSleepingWhenIdle() const noexcept { return _sleepWhenIdle; }
+
+        // Time left before the next System is due. Zero if one already is, or if a System's framerate isn't limited
+        putils::Timer::t_duration getTimeUntilNextSystem() noexcept {
+            updateSystemList();
+
+            const auto zero = putils::Timer::t_duration::zero();
+            if (_order.empty())
+                return zero;
+
+            auto ret = _order.front()->time.fixedDeltaTime;
+            for (const auto s : _order) {
+                if (s->time.alwaysCall)
+                    return zero;
+                const auto timeLeft = -s->time.timer.getTimeSinceDone();
+                if (timeLeft <= zero)
+                    return zero;
+                ret = std::min(ret, timeLeft);
+            }
+            return ret;
+        }
+
+    protected:
+        // Changes made at or before this tick won't be matched by Changed<T> in any System that already ran, see ComponentManager::pruneChanges
+        // Systems that never ran match all Components the first time, without relying on change lists
+        std::uint64_t getOldestRunTick() const noexcept {
+            auto ret = detail::changeTickCounter().load(std::memory_order_relaxed);
+            for (const auto s : _order)
+                if (s->_ticks.current != 0)
+                    ret = std::min(ret, s->_ticks.current);
+            return ret;
+        }
+
+    public:
+        // Blocks until the next System is due, or until wakeUp is called
+        void waitForNextSystem() {
+            if (_first)
+                return;
+
+            const auto timeLeft = getTimeUntilNextSystem();
+            if (timeLeft <= putils::Timer::t_duration::zero())
+                return;
+
+            std::unique_lock<std::mutex> lock(_wakeMutex);
+            _wakeCondition.wait_for(lock, timeLeft, [this] { return _wakeRequested; });
+            _wakeRequested = false;
+        }
+
+        // Interrupts waitForNextSystem. Thread-safe, meant to be called by threads that send packets
+        // or set running to false, so that they're processed without waiting for the next System
+        void wakeUp() const {
+            {
+                std::lock_guard<std::mutex> lock(_wakeMutex);
+                _wakeRequested = true;
+            }
+            _wakeCondition.notify_all();
+        }
+
+    protected:
+        // Called when work is queued or packets are sent. The thread calling execute checks its queues before waiting,
+        // so only other threads need to wake it up
+        void wakeUpFromOtherThread() const {
+            if (_sleepWhenIdle && !isSystemThread())
+                wakeUp();
+        }
+
+    public:
+        // With more than one thread, Systems that declared their accesses (see ISystem::reads, writes and sends)
+        // and don't conflict with each other are run concurrently, and betweenSystems is called after each batch
+        // With a single thread (the default), Systems are run one after the other, in the order they were added
+        void setThreadCount(std::size_t threads) {
+            if (threads <= 1)
+                _threadPool = nullptr;
+            else
+                _threadPool = std::make_unique<ThreadPool>(threads);
+
+            for (const auto & channel : _deferredOrder)
+                channel.second->setThreadCount(getThreadCount());
+            _commandBuffers.setThreadCount(getThreadCount());
+        }
+
+        std::size_t getThreadCount() const noexcept { return _threadPool != nullptr ? _threadPool->getThreadCount() : 1; }
+
+        // Index of the calling thread, in [0, getThreadCount()), to be used for per-thread scratch storage
+        std::size_t getThreadIndex() const noexcept { return _threadPool != nullptr ? _threadPool->getThreadIndex() : 0; }
+
+        // Calls func(begin, end) for consecutive chunks of at most chunkSize indexes in [0, count), spread over all threads
+        // Commands recorded from a chunk are played back in the order of the chunks, see CommandBuffer
+        template<typename Func>
+        void parallelFor(std::size_t count, std::size_t chunkSize, Func && func) {
+            // The chunks get the next sequence number, and commands recorded by the caller after the loop the one after that
+            // Nested calls record with the sequence number of the enclosing chunk
+            auto & callerOrigin = detail::currentCommandOrigin();
+            auto origin = callerOrigin;
+            if (origin.chunk == 0) {
+                ++origin.sequence;
+                callerOrigin.sequence += 2;
+            }
+
+            const auto runChunk = [&func, origin](std::size_t begin, std::size_t end) {
+                auto & currentOrigin = detail::currentCommandOrigin();
+                const auto previousOrigin = currentOrigin;
+                currentOrigin = { origin.system, origin.sequence, begin + 1 };
+                func(begin, end);
+                currentOrigin = previousOrigin;
+            };
+
+            if (_threadPool != nullptr) {
+                // Components changed from worker threads are stamped with the calling System's tick
+                const auto ticks = detail::currentSystemTicks();
+                _threadPool->parallelFor(count, chunkSize, [&runChunk, ticks](std::size_t begin, std::size_t end) {
+                    auto & current = detail::currentSystemTicks();
+                    const auto previous = current;
+                    current = ticks;
+                    runChunk(begin, end);
+                    current = previous;
+                });
+                return;
+            }
+
+            chunkSize = std::max<std::size_t>(chunkSize, 1);
+            for (std::size_t begin = 0; begin < count; begin += chunkSize)
+                runChunk(begin, std::min(begin + chunkSize, count));
+        }
+
+    public:
+        // Shadows putils::Mediator's, to go through the PacketDispatcher instead of broadcasting to every Module
+        template<typename P>
+        void send(const P & packet) const {
+            _dispatcher.dispatch(packet);
+            wakeUpFromOtherThread();
+        }
+
+        // Shadow putils::Mediator's, so that Modules that aren't Systems still receive the packets sent by Systems
+        // Modules added directly through a putils::Mediator & only receive packets sent through the Mediator
+        void addModule(putils::BaseModule & module) {
+            putils::Mediator::addModule(module);
+            if (dynamic_cast<ISystem *>(&module) == nullptr) {
+                _dispatcher.addModule(module);
+                updateDeferredHandlers();
+            }
+        }
+
+        void removeModule(putils::BaseModule & module) {
+            putils::Mediator::removeModule(module);
+            _dispatcher.removeModule(module);
+            updateDeferredHandlers();
+        }
+
+    public:
+        // Buffers packet in the DeferredChannel for P, see DeferredChannel.md
+        // Buffered packets are delivered as packets::Batch<P> once the current System (or batch of Systems) is done
+        // Threads running Systems don't lock, others (e.g. a render or loading thread) share a locked buffer
+        // If no channel was opened for P, packet is sent immediately
+        template<typename P>
+        void sendDeferred(const P & packet) {
+            const auto it = _deferredChannels.find(pmeta::type<P>::index);
+            if (it == _deferredChannels.end()) {
+                send(packet);
+                return;
+            }
+
+            auto & channel = static_cast<DeferredChannel<P> &>(*it->second);
+            if (isSystemThread())
+                channel.push(getThreadIndex(), packet);
+            else
+                channel.pushLocked(packet);
+        }
+
+        // Whether the calling thread runs Systems: the one calling execute, or a worker of the ThreadPool
+        bool isSystemThread() const noexcept {
+            return (_threadPool != nullptr && _threadPool->isWorker()) ||
+                   _executingThread.load(std::memory_order_relaxed) == std::this_thread::get_id();
+        }
+
+        // Channels are automatically opened for the packets::Batch<P> handled by Systems
+        // Must not be called while Systems are executing
+        template<typename P>
+        void openDeferredChannel() {
+            const auto type = pmeta::type<P>::index;
+            if (_deferredChannels.find(type) != _deferredChannels.end())
+                return;
+
+            auto channel = std::make_unique<DeferredChannel<P>>(getThreadCount());
+            channel->sendIndividually = isHandled(type);
+            _deferredOrder.emplace_back(pmeta::type<packets::Batch<P>>::index, channel.get());
+            _deferredChannels.emplace(type, std::move(channel));
+        }
+
+    private:
+        void flushDeferred() {
+            for (const auto & [batchType, channel] : _deferredOrder) {
+                const auto batches = channel->flush(_dispatcher);
+#ifndef KENGINE_NO_STATS
+                if (_statsEnabled)
+                    for (std::size_t i = 0; i < batches; ++i)
+                        countPacketReceived(batchType, nullptr);
+#else
+                (void)batches;
+#endif
+            }
+        }
+
+        // Systems handling P itself rather than packets::Batch<P>, and Modules that aren't Systems, get deferred packets one by one
+        void updateDeferredHandlers() noexcept {
+            for (auto & [type, channel] : _deferredChannels)
+                channel->sendIndividually = isHandled(type);
+        }
+
+        bool isHandled(pmeta::type_index packet) const noexcept {
+            if (_dispatcher.hasModules()) // They receive every packet
+                return true;
+            return std::any_of(_order.begin(), _order.end(), [packet](const ISystem * s) { return handles(*s, packet); });
+        }
+
+    public:
+        // Batches of Systems that may run concurrently, in execution order
+        const std::vector<std::vector<ISystem *>> & getSchedule() {
+            updateSystemList();
+            if (_scheduleDirty)
+                updateSchedule();
+            return _schedule;
         }
 
     private:
         void updateSystemList() noexcept {
-            for (auto &p : _toAdd)
-                _systems.emplace(p.first, std::move(p.second));
+            bool changed = false;
+
+            // Duplicates are dropped, and the handlers added for them by addSystem are undone
+            const auto dropDuplicate = [this](ISystem & system) {
+                putils::Mediator::removeModule(system);
+            };
+
+            for (auto &p : _toAdd) {
+                if (getSystemSlot(p.first) != nullptr) { // Already loaded, possibly by a StaticSystemManager
+                    dropDuplicate(*p.second);
+                    changed = true;
+                    continue;
+                }
+
+                const auto [it, inserted] = _systems.try_emplace(p.first, std::move(p.second));
+                if (inserted) {
+                    setSystemSlot(p.first, it->second.get());
+                    _order.push_back(it->second.get());
+                    it->second->openDeferredChannels(*this);
+                }
+                else
+                    dropDuplicate(*p.second);
+                changed = true; // Handlers were added by addSystem, even for duplicates
+            }
             _toAdd.clear();
 
             for (const auto index : _toRemove) {
                 const auto it = _systems.find(index);
-                if (it != _systems.end())
+                if (it != _systems.end()) {
+                    _order.erase(std::find(_order.begin(), _order.end(), it->second.get()));
+                    putils::Mediator::removeModule(*it->second);
+                    setSystemSlot(index, nullptr);
                     _systems.erase(it);
+                    changed = true;
+                }
             }
             _toRemove.clear();
+
+            if (!changed)
+                return;
+
+            for (std::size_t i = 0; i < _order.size(); ++i)
+                _order[i]->_position = i;
+            _scheduleDirty = true;
+            updateDeferredHandlers();
+            updateDispatcher();
+#ifndef KENGINE_NO_STATS
+            if (_statsEnabled)
+                updateStatsBindings();
+#endif
+        }
+
+        ISystem * getSystemSlot(pmeta::type_index type) const noexcept {
+            const auto id = detail::getSystemId(type);
+            return id < _systemsById.size() ? _systemsById[id] : nullptr;
+        }
+
+        void setSystemSlot(pmeta::type_index type, ISystem * system) {
+            const auto id = detail::getSystemId(type);
+            if (id >= _systemsById.size())
+                _systemsById.resize(id + 1, nullptr);
+            _systemsById[id] = system;
+        }
+
+        // Handlers are stored in the order in which Systems were added, which is the order in which they receive packets
+        // Static Systems are reached through static routes instead
+        void updateDispatcher() {
+            _dispatcher.clear();
+            for (auto it = _order.begin() + _staticSystems; it != _order.end(); ++it)
+                (*it)->registerHandlers(_dispatcher);
+        }
+
+        static bool handles(const ISystem & s, pmeta::type_index packet) noexcept {
+            const auto handled = s.getHandledPackets();
+            return std::find(handled.begin(), handled.end(), packet) != handled.end();
+        }
+
+        static bool isDue(ISystem & s) noexcept { return s.time.alwaysCall || s.time.timer.isDone(); }
+
+    private:
+        struct Resources {
+            std::vector<pmeta::type_index> reads;
+            std::vector<pmeta::type_index> writes; // Packets sent or handled are considered written
+        };
+
+        static Resources getResources(const ISystem & s) noexcept {
+            const auto & access = s.getAccess();
+
+            Resources ret{ access.reads, access.writes };
+            ret.writes.insert(ret.writes.end(), access.sends.begin(), access.sends.end());
+            const auto handled = s.getHandledPackets();
+            ret.writes.insert(ret.writes.end(), handled.begin(), handled.end());
+
+            for (auto v : { &ret.reads, &ret.writes }) {
+                std::sort(v->begin(), v->end());
+                v->erase(std::unique(v->begin(), v->end()), v->end());
+            }
+            return ret;
+        }
+
+        static bool intersect(const std::vector<pmeta::type_index> & a, const std::vector<pmeta::type_index> & b) noexcept {
+            auto itA = a.begin();
+            auto itB = b.begin();
+            while (itA != a.end() && itB != b.end()) {
+                if (*itA < *itB)
+                    ++itA;
+                else if (*itB < *itA)
+                    ++itB;
+                else
+                    return true;
+            }
+            return false;
+        }
+
+        static bool conflict(const Resources & a, const Resources & b) noexcept {
+            return intersect(a.writes, b.writes) || intersect(a.writes, b.reads) || intersect(a.reads, b.writes);
+        }
+
+        // Each System is placed in the batch following the last one containing an earlier System it conflicts with,
+        // so conflicting Systems keep the order in which they were added. Exclusive Systems get a batch of their own
+        void updateSchedule() noexcept {
+            _schedule.clear();
+            _scheduleDirty = false;
+
+            std::vector<Resources> resources;
+            std::vector<std::size_t> batches;
+            std::size_t barrier = 0; // First batch after the last exclusive System
+
+            for (std::size_t i = 0; i < _order.size(); ++i) {
+                const auto & s = *_order[i];
+                resources.push_back(getResources(s));
+
+                std::size_t batch = barrier;
+                if (!s.getAccess().declared) {
+                    batch = _schedule.size();
+                    barrier = batch + 1;
+                }
+                else
+                    for (std::size_t j = 0; j < i; ++j)
+                        if (batches[j] >= batch && conflict(resources[i], resources[j]))
+                            batch = batches[j] + 1;
+
+                if (batch >= _schedule.size())
+                    _schedule.resize(batch + 1);
+                _schedule[batch].push_back(_order[i]);
+                batches.push_back(batch);
+            }
         }
 
     private:
         void resetTimers() {
-            for (auto & [type, s] : _systems) {
+            for (const auto s : _order) {
                 s->time.lastCall = putils::Timer::t_clock::now();
                 s->time.timer.restart();
             }
@@ -85,6 +658,20 @@ namespace kengine {
 
     private:
         bool _first = true;
+        // See isSystemThread. Until execute is first called, assumed to be the thread creating the SystemManager
+        std::atomic<std::thread::id> _executingThread{ std::this_thread::get_id() };
+
+        bool _statsEnabled = false;
+        putils::Timer _statsReportTimer;
+#ifndef KENGINE_NO_STATS
+        std::unordered_map<pmeta::type_index, std::unique_ptr<detail::StatsRecorder>> _statsRecorders; // Indexed by System type
+        std::unordered_map<pmeta::type_index, std::vector<detail::StatsRecorder *>> _statsHandlers; // Indexed by packet type
+#endif
+
+        bool _sleepWhenIdle = false;
+        mutable std::mutex _wakeMutex;
+        mutable std::condition_variable _wakeCondition;
+        mutable bool _wakeRequested = false;
 
     public:
         template<typename T, typename ...Args>
@@ -95,20 +682,11 @@ namespace kengine {
         }
 
         ISystem & addSystem(std::unique_ptr<ISystem> && system) {
-            const auto nbFrames = system->getFrameRate();
+            initTime(*system);
 
-            auto & time = system->time;
-            if (nbFrames == 0) {
-                time.alwaysCall = true;
-                time.fixedDeltaTime = std::chrono::seconds(0);
-            } else {
-                time.alwaysCall = false;
-                time.fixedDeltaTime = std::chrono::milliseconds(1000 / nbFrames);
-            }
-            time.lastCall = putils::Timer::t_clock::now();
-            time.timer.setDuration(time.fixedDeltaTime);
-
-            addModule(*system);
+            putils::Mediator::addModule(*system);
+            system->_dispatcher = &_dispatcher;
+            system->registerHandlers(_dispatcher);
             const auto type = system->getType();
 
             auto & ret = *system;
@@ -120,6 +698,59 @@ namespace kengine {
             return ret;
         }
 
+    protected:
+        // Used by StaticSystemManager, which owns system. Static Systems come first in the execution order,
+        // and must all be added before the first call to execute
+        void addStaticSystem(ISystem & system) {
+            initTime(system);
+
+            putils::Mediator::addModule(system);
+            system._dispatcher = &_dispatcher;
+
+            setSystemSlot(system.getType(), &system);
+            _order.insert(_order.begin() + _staticSystems, &system);
+            ++_staticSystems;
+            for (std::size_t i = 0; i < _order.size(); ++i)
+                _order[i]->_position = i;
+
+            system.openDeferredChannels(*this);
+            updateDeferredHandlers();
+            _scheduleDirty = true;
+        }
+
+        // Called by StaticSystemManager before its Systems are destroyed
+        void removeStaticSystems() noexcept {
+            for (std::size_t i = 0; i < _staticSystems; ++i) {
+                putils::Mediator::removeModule(*_order[i]);
+                setSystemSlot(_order[i]->getType(), nullptr);
+            }
+            _order.erase(_order.begin(), _order.begin() + _staticSystems);
+            _staticSystems = 0;
+            // The routes point into the StaticSystemManager, packets sent after this must not reach its Systems
+            _dispatcher.clearStaticRoutes();
+            updateDeferredHandlers();
+            _scheduleDirty = true;
+        }
+
+        template<typename P>
+        void setStaticRoute(const PacketDispatcher::StaticRoute & route) { _dispatcher.setStaticRoute<P>(route); }
+
+    private:
+        void initTime(ISystem & system) {
+            const auto nbFrames = system.getFrameRate();
+
+            auto & time = system.time;
+            if (nbFrames == 0) {
+                time.alwaysCall = true;
+                time.fixedDeltaTime = std::chrono::seconds(0);
+            } else {
+                time.alwaysCall = false;
+                time.fixedDeltaTime = std::chrono::milliseconds(1000 / nbFrames);
+            }
+            time.lastCall = putils::Timer::t_clock::now();
+            time.timer.setDuration(time.fixedDeltaTime);
+        }
+
     public:
         template<typename ...Systems>
         void loadSystems(const std::string & pluginDir = "", const std::string & creatorFunction = "getSystem", bool pluginsFirst = false) {
@@ -153,22 +784,25 @@ namespace kengine {
         }
 
     public:
+        // Throws std::out_of_range if T isn't loaded
         template<typename T>
         T & getSystem() {
-            static_assert(std::is_base_of<ISystem, T>::value, "Attempt to get something that isn't a System");
-            return static_cast<T &>(*_systems.at(pmeta::type<T>::index));
+            return const_cast<T &>(static_cast<const SystemManager &>(*this).getSystem<T>());
         }
 
         template<typename T>
         const T & getSystem() const {
             static_assert(std::is_base_of<ISystem, T>::value, "Attempt to get something that isn't a System");
-            return static_cast<const T &>(*_systems.at(pmeta::type<T>::index));
+            if (!hasSystem<T>())
+                throw std::out_of_range("[kengine] Attempt to get a System that isn't loaded");
+            return static_cast<const T &>(*_systemsById[detail::systemId<T>()]);
         }
 
         template<typename T>
         bool hasSystem() const noexcept {
             static_assert(std::is_base_of<ISystem, T>::value, "Attempt to check something that isn't a System");
-            return _systems.find(pmeta::type<T>::index) != _systems.end();
+            const auto id = detail::systemId<T>();
+            return id < _systemsById.size() && _systemsById[id] != nullptr;
         }
 
         template<typename T>
@@ -189,17 +823,92 @@ namespace kengine {
 
     protected:
         void registerGameObject(GameObject & gameObject) noexcept {
+#ifndef KENGINE_NO_STATS
+            if (_statsEnabled)
+                countPacketReceived(pmeta::type<kengine::packets::RegisterGameObject>::index, nullptr);
+#endif
             send(kengine::packets::RegisterGameObject{ gameObject });
         }
 
+        // Sends a single RegisterGameObjects packet for the whole batch
+        // RegisterGameObject is only sent for each GameObject if a System or another Module may handle it
+        void registerGameObjects(const std::vector<GameObject *> & gameObjects) noexcept {
+            if (gameObjects.empty())
+                return;
+
+#ifndef KENGINE_NO_STATS
+            if (_statsEnabled)
+                countPacketReceived(pmeta::type<kengine::packets::RegisterGameObjects>::index, nullptr);
+#endif
+            send(kengine::packets::RegisterGameObjects{ gameObjects });
+
+            if (_dispatcher.hasReceivers<kengine::packets::RegisterGameObject>())
+                for (const auto go : gameObjects)
+                    registerGameObject(*go);
+        }
+
         void removeGameObject(GameObject & gameObject) {
+#ifndef KENGINE_NO_STATS
+            if (_statsEnabled)
+                countPacketReceived(pmeta::type<kengine::packets::RemoveGameObject>::index, nullptr);
+#endif
             send(kengine::packets::RemoveGameObject{ gameObject });
         }
 
+        void enableGameObject(GameObject & gameObject) noexcept {
+#ifndef KENGINE_NO_STATS
+            if (_statsEnabled)
+                countPacketReceived(pmeta::type<kengine::packets::EnableGameObject>::index, nullptr);
+#endif
+            send(kengine::packets::EnableGameObject{ gameObject });
+        }
+
+        void disableGameObject(GameObject & gameObject) noexcept {
+#ifndef KENGINE_NO_STATS
+            if (_statsEnabled)
+                countPacketReceived(pmeta::type<kengine::packets::DisableGameObject>::index, nullptr);
+#endif
+            send(kengine::packets::DisableGameObject{ gameObject });
+        }
+
+    protected:
+        detail::CommandBuffers _commandBuffers; // Played back by the EntityManager
+
     private:
         double _speed = 1;
+        PacketDispatcher _dispatcher;
+        std::unique_ptr<ThreadPool> _threadPool;
+        std::vector<ISystem *> _order; // Order in which Systems were added
+        std::size_t _staticSystems = 0; // Systems at the front of _order, owned by a StaticSystemManager
+        std::vector<std::vector<ISystem *>> _schedule;
+        bool _scheduleDirty = true;
         std::vector<std::pair<pmeta::type_index, std::unique_ptr<ISystem>>> _toAdd;
         std::vector<pmeta::type_index> _toRemove;
         std::unordered_map<pmeta::type_index, std::unique_ptr<ISystem>> _systems;
+        std::vector<ISystem *> _systemsById; // Indexed by detail::getSystemId, null for Systems that aren't loaded
+        std::unordered_map<pmeta::type_index, std::unique_ptr<detail::IDeferredChannel>> _deferredChannels; // Indexed by packet type
+        std::vector<std::pair<pmeta::type_index, detail::IDeferredChannel *>> _deferredOrder; // Flush order, with the type of packets::Batch<P>
     };
+
+    namespace detail {
+        template<typename P>
+        void openDeferredChannel(SystemManager &, P *) noexcept {}
+
+        template<typename P>
+        void openDeferredChannel(SystemManager & manager, packets::Batch<P> *) { manager.openDeferredChannel<P>(); }
+    }
+
+    template<typename CRTP, typename ...DataPackets>
+    void System<CRTP, DataPackets...>::openDeferredChannels(SystemManager & manager) const {
+        (detail::openDeferredChannel(manager, (DataPackets *)nullptr), ...);
+    }
+
+#ifndef KENGINE_NO_STATS
+    inline void ISystem::countPacketSent(pmeta::type_index type, const putils::BaseModule * dest) const noexcept {
+        if (_stats == nullptr)
+            return;
+        ++_stats->packetsSent;
+        _statsManager->countPacketReceived(type, dest);
+    }
+#endif
 }
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string>
+#include <array>
+#include <vector>
+#include <atomic>
+#include <algorithm>
+#include "meta/type.hpp"
+#include "reflection/Reflectible.hpp"
+
+namespace kengine {
+    // Statistics recorded by the SystemManager for each System, see SystemManager::setStatsEnabled
+    // Times are in milliseconds. min, mean, max and percentiles are computed over the last WINDOW calls to execute
+    struct SystemStats {
+        static constexpr std::size_t WINDOW = 128;
+
+        std::string name;
+        pmeta::type_index type;
+
+        std::size_t calls = 0;
+        double lastTime = 0;
+        double totalTime = 0;
+        double minTime = 0;
+        double meanTime = 0;
+        double maxTime = 0;
+        double p95Time = 0;
+        double p99Time = 0;
+
+        std::size_t packetsSent = 0;
+        std::size_t packetsReceived = 0;
+
+        std::size_t entitiesVisited = 0; // Size of the entity lists obtained during the last call to execute
+        std::size_t totalEntitiesVisited = 0;
+
+        /*
+         * Reflectible
+         */
+
+        pmeta_get_class_name(SystemStats);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&SystemStats::name),
+                pmeta_reflectible_attribute(&SystemStats::calls),
+                pmeta_reflectible_attribute(&SystemStats::lastTime),
+                pmeta_reflectible_attribute(&SystemStats::totalTime),
+                pmeta_reflectible_attribute(&SystemStats::minTime),
+                pmeta_reflectible_attribute(&SystemStats::meanTime),
+                pmeta_reflectible_attribute(&SystemStats::maxTime),
+                pmeta_reflectible_attribute(&SystemStats::p95Time),
+                pmeta_reflectible_attribute(&SystemStats::p99Time),
+                pmeta_reflectible_attribute(&SystemStats::packetsSent),
+                pmeta_reflectible_attribute(&SystemStats::packetsReceived),
+                pmeta_reflectible_attribute(&SystemStats::entitiesVisited),
+                pmeta_reflectible_attribute(&SystemStats::totalEntitiesVisited)
+        );
+        pmeta_get_methods();
+        pmeta_get_parents();
+    };
+
+    namespace detail {
+        // Live counters for a System. Packet counters may be incremented from any thread
+        struct StatsRecorder {
+            std::size_t calls = 0;
+            double totalTime = 0;
+            std::array<double, SystemStats::WINDOW> samples;
+
+            std::atomic<std::size_t> packetsSent{ 0 };
+            std::atomic<std::size_t> packetsReceived{ 0 };
+
+            std::size_t entitiesVisited = 0;
+            std::size_t totalEntitiesVisited = 0;
+
+            void record(double time) noexcept {
+                samples[calls % samples.size()] = time;
+                ++calls;
+                totalTime += time;
+                totalEntitiesVisited += entitiesVisited;
+            }
+
+            SystemStats get() const {
+                SystemStats ret;
+                ret.calls = calls;
+                ret.totalTime = totalTime;
+                ret.packetsSent = packetsSent;
+                ret.packetsReceived = packetsReceived;
+                ret.entitiesVisited = entitiesVisited;
+                ret.totalEntitiesVisited = totalEntitiesVisited;
+
+                if (calls == 0)
+                    return ret;
+
+                ret.lastTime = samples[(calls - 1) % samples.size()];
+
+                std::vector<double> window(samples.begin(), samples.begin() + std::min(calls, samples.size()));
+                std::sort(window.begin(), window.end());
+                ret.minTime = window.front();
+                ret.maxTime = window.back();
+                double sum = 0;
+                for (const auto t : window)
+                    sum += t;
+                ret.meanTime = sum / window.size();
+                ret.p95Time = window[(window.size() - 1) * 95 / 100];
+                ret.p99Time = window[(window.size() - 1) * 99 / 100];
+                return ret;
+            }
+        };
+
+        // Recorder for the System currently executing on this thread, if stats are enabled
+        inline StatsRecorder * & currentStatsRecorder() noexcept {
+            static thread_local StatsRecorder * current = nullptr;
+            return current;
+        }
+    }
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <exception>
+
+namespace kengine {
+    // Work-stealing thread pool, used by the SystemManager to run independent Systems concurrently and by Systems to split work
+    // Each worker has its own queue, from which it pops the most recent task, and steals the oldest tasks from other queues when empty
+    // Threads waiting for tasks to complete help run queued tasks, so parallel loops may be nested
+    class ThreadPool {
+    public:
+        // threads is the number of threads, including the one calling parallelFor
+        ThreadPool(std::size_t threads) {
+            threads = std::max<std::size_t>(threads, 1);
+            for (std::size_t i = 0; i < threads; ++i) // Queue 0 is shared by non-worker threads
+                _queues.push_back(std::make_unique<Queue>());
+            for (std::size_t i = 1; i < threads; ++i)
+                _workers.emplace_back([this, i] { workerLoop(i); });
+        }
+
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(_sleepMutex);
+                _stop = true;
+            }
+            _wakeWorkers.notify_all();
+            for (auto & t : _workers)
+                t.join();
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool & operator=(const ThreadPool &) = delete;
+
+    public:
+        std::size_t getThreadCount() const noexcept { return _queues.size(); }
+
+        // Index of the calling thread, in [0, getThreadCount()). Threads that aren't part of the pool get 0
+        // Useful to index per-thread scratch storage
+        std::size_t getThreadIndex() const noexcept {
+            const auto & current = getCurrentWorker();
+            return current.pool == this ? current.index : 0;
+        }
+
+        // Whether the calling thread is one of the pool's workers, rather than a thread calling parallelFor
+        bool isWorker() const noexcept { return getCurrentWorker().pool == this; }
+
+        // Calls func(begin, end) for consecutive chunks of at most chunkSize indexes in [0, count)
+        // Returns once all chunks have been processed, rethrowing the first exception thrown by func
+        template<typename Func>
+        void parallelFor(std::size_t count, std::size_t chunkSize, Func && func) {
+            if (count == 0)
+                return;
+
+            chunkSize = std::max<std::size_t>(chunkSize, 1);
+            const auto chunks = (count + chunkSize - 1) / chunkSize;
+            if (chunks == 1 || _workers.empty()) {
+                for (std::size_t begin = 0; begin < count; begin += chunkSize)
+                    func(begin, std::min(begin + chunkSize, count));
+                return;
+            }
+
+            Group group;
+            group.remaining = chunks;
+
+            const auto runChunk = [&group, &func, count, chunkSize](std::size_t chunk) {
+                const auto begin = chunk * chunkSize;
+                const auto end = std::min(begin + chunkSize, count);
+                try {
+                    func(begin, end);
+                }
+                catch (...) {
+                    std::lock_guard<std::mutex> lock(group.mutex);
+                    if (group.exception == nullptr)
+                        group.exception = std::current_exception();
+                }
+                --group.remaining;
+            };
+
+            {
+                auto & queue = *_queues[getThreadIndex()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                for (std::size_t chunk = chunks - 1; chunk > 0; --chunk)
+                    queue.tasks.emplace_back([&runChunk, chunk] { runChunk(chunk); });
+            }
+            notifyPushed(chunks - 1);
+
+            runChunk(0);
+            wait(group);
+
+            if (group.exception != nullptr)
+                std::rethrow_exception(group.exception);
+        }
+
+        // Calls func(i) for each i in [0, count), each call being a separate task
+        template<typename Func>
+        void forEachIndex(std::size_t count, Func && func) {
+            parallelFor(count, 1, [&func](std::size_t begin, std::size_t) { func(begin); });
+        }
+
+    private:
+        using Task = std::function<void()>;
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        struct Group {
+            std::atomic<std::size_t> remaining{ 0 };
+            std::mutex mutex;
+            std::exception_ptr exception = nullptr;
+        };
+
+        struct CurrentWorker {
+            const ThreadPool * pool = nullptr;
+            std::size_t index = 0;
+        };
+
+        static CurrentWorker & getCurrentWorker() noexcept {
+            static thread_local CurrentWorker current;
+            return current;
+        }
+
+    private:
+        void notifyPushed(std::size_t count) {
+            {
+                std::lock_guard<std::mutex> lock(_sleepMutex);
+                _pending += count;
+            }
+            if (count == 1)
+                _wakeWorkers.notify_one();
+            else
+                _wakeWorkers.notify_all();
+        }
+
+        // Pops from the calling thread's own queue, then tries to steal from the others
+        bool runOne() {
+            const auto self = getThreadIndex();
+            Task task;
+
+            for (std::size_t i = 0; i < _queues.size() && task == nullptr; ++i) {
+                auto & queue = *_queues[(self + i) % _queues.size()];
+                std::lock_guard<std::mutex> lock(queue.mutex);
+                if (queue.tasks.empty())
+                    continue;
+                if (i == 0) {
+                    task = std::move(queue.tasks.back());
+                    queue.tasks.pop_back();
+                }
+                else {
+                    task = std::move(queue.tasks.front());
+                    queue.tasks.pop_front();
+                }
+            }
+
+            if (task == nullptr)
+                return false;
+
+            {
+                std::lock_guard<std::mutex> lock(_sleepMutex);
+                --_pending;
+            }
+            task();
+            return true;
+        }
+
+        void wait(const Group & group) {
+            while (group.remaining > 0)
+                if (!runOne())
+                    std::this_thread::yield();
+        }
+
+        void workerLoop(std::size_t index) {
+            getCurrentWorker() = { this, index };
+
+            while (true) {
+                if (runOne())
+                    continue;
+
+                std::unique_lock<std::mutex> lock(_sleepMutex);
+                _wakeWorkers.wait(lock, [this] { return _stop || _pending > 0; });
+                if (_stop)
+                    return;
+            }
+        }
+
+    private:
+        std::vector<std::unique_ptr<Queue>> _queues; // Indexed by thread index
+        std::vector<std::thread> _workers;
+
+        std::mutex _sleepMutex;
+        std::condition_variable _wakeWorkers;
+        std::size_t _pending = 0; // Number of queued tasks, protected by _sleepMutex
+        bool _stop = false;
+    };
+}
@@ -0,0 +1,324 @@
+#pragma once
+
+#include <cmath>
+#include <vector>
+#include <mutex>
+#include <limits>
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+#include "GameObject.hpp"
+#include "common/components/TransformComponent.hpp"
+
+namespace kengine {
+    // Parent/child links between GameObjects. A child's TransformComponent3d follows its parent's, offset by a local transform
+    // Children are stored contiguously in depth-first order, so parents are always updated before their children
+    // and each subtree can be updated on its own
+    class TransformHierarchy {
+    public:
+        TransformHierarchy() noexcept {
+            detail::changeListener<TransformComponent3d>().store(&onTransformChanged, std::memory_order_relaxed);
+        }
+
+    public:
+        // Relative to the parent: position is rotated by the parent's yaw and pitch, which are added to the child's
+        struct LocalTransform {
+            putils::Point3d position;
+            double pitch = 0; // Radians
+            double yaw = 0; // Radians
+        };
+
+    public:
+        // Throws std::logic_error if child is parent, or one of its ancestors
+        // The local transform is set so that child stays where it is
+        void addLink(GameObject & parent, GameObject & child) {
+            for (auto ancestor = &parent; ancestor != nullptr; ancestor = getParentOrNull(*ancestor))
+                if (ancestor == &child)
+                    throw std::logic_error("[kengine] Attempt to make a GameObject its own ancestor");
+
+            removeLink(child);
+
+            Node node;
+            node.go = &child;
+            node.parent = &parent;
+            if (parent.hasComponent<TransformComponent3d>() && child.hasComponent<TransformComponent3d>())
+                node.local = toLocal(getTransform(parent), getTransform(child));
+
+            _indexes.emplace(&child, _nodes.size());
+            _nodes.push_back(node);
+            ++_childCounts[&parent];
+            _sorted = false;
+
+            child._hierarchy = this;
+            parent._hierarchy = this;
+        }
+
+        void removeLink(const GameObject & child) noexcept {
+            const auto it = _indexes.find(&child);
+            if (it == _indexes.end())
+                return;
+
+            const auto index = it->second;
+            const auto go = _nodes[index].go;
+            const auto parent = _nodes[index].parent;
+            if (--_childCounts[parent] == 0)
+                _childCounts.erase(parent);
+
+            // The last node takes its place, and nodes are sorted again by the next update
+            _indexes.erase(it);
+            if (index != _nodes.size() - 1) {
+                _nodes[index] = _nodes.back();
+                _indexes[_nodes[index].go] = index;
+            }
+            _nodes.pop_back();
+            _sorted = false;
+
+            updateLinked(*go);
+            updateLinked(*parent);
+        }
+
+        // Removes go's link to its parent, and its children's links to it. Its children keep their current transform
+        void removeGameObject(const GameObject & go) noexcept {
+            removeLink(go);
+            if (_childCounts.find(&go) == _childCounts.end())
+                return;
+
+            std::vector<const GameObject *> children;
+            for (const auto & node : _nodes)
+                if (node.parent == &go)
+                    children.push_back(node.go);
+            for (const auto child : children)
+                removeLink(*child);
+        }
+
+        // Throws std::out_of_range if go has no parent
+        const GameObject & getParent(const GameObject & go) const { return *_nodes[_indexes.at(&go)].parent; }
+
+        bool hasParent(const GameObject & go) const noexcept { return _indexes.find(&go) != _indexes.end(); }
+
+    public:
+        // Throws std::out_of_range if child has no parent
+        const LocalTransform & getLocalTransform(const GameObject & child) const { return _nodes[_indexes.at(&child)].local; }
+
+        // child's TransformComponent3d is updated by the next call to update
+        // Throws std::out_of_range if child has no parent
+        void setLocalTransform(const GameObject & child, const LocalTransform & local) {
+            auto & node = _nodes[_indexes.at(&child)];
+            node.local = local;
+            node.localChanged = true;
+            markMoved(*node.go);
+        }
+
+    public:
+        // Recomputes the TransformComponent3d of the children whose parent moved, or whose local transform was set
+        // A child whose TransformComponent3d was modified directly while its parent didn't move keeps its new transform,
+        // and its local transform is updated to match
+        // A child whose parent has no TransformComponent3d is left as is, and its own children follow it
+        // Only the subtrees under GameObjects whose transform changed are visited, so static subtrees cost nothing
+        // Must not be called while Systems are executing. Called by the EntityManager at each sync point
+        void update() {
+            std::vector<const GameObject *> moved;
+            {
+                const std::lock_guard<std::mutex> lock(_movedMutex);
+                moved.swap(_moved);
+            }
+
+            if (!_sorted) { // Links changed, update everything
+                sort();
+                updateRange(0, _nodes.size());
+            }
+            else if (!moved.empty()) {
+                // Subtrees are either nested or disjoint, so nested ones are skipped once sorted
+                std::vector<std::pair<std::size_t, std::size_t>> ranges;
+                for (const auto go : moved) {
+                    const auto node = _indexes.find(go);
+                    if (node != _indexes.end())
+                        ranges.emplace_back(node->second, _nodes[node->second].end);
+                    const auto anchor = _anchors.find(go);
+                    if (anchor != _anchors.end())
+                        ranges.push_back(anchor->second);
+                }
+
+                std::sort(ranges.begin(), ranges.end(), [](const auto & lhs, const auto & rhs) {
+                    return lhs.first < rhs.first || (lhs.first == rhs.first && lhs.second > rhs.second);
+                });
+                std::size_t updated = 0;
+                for (const auto & [begin, end] : ranges)
+                    if (begin >= updated) {
+                        updateRange(begin, end);
+                        updated = end;
+                    }
+            }
+            else
+                return;
+
+            // The transforms set above notified us, but their children are already up to date
+            {
+                const std::lock_guard<std::mutex> lock(_movedMutex);
+                _moved.clear();
+            }
+            // Changes made from now on must have a later tick than the ones made above
+            _lastUpdate = detail::changeTickCounter()++;
+        }
+
+    private:
+        static constexpr auto NO_PARENT = std::numeric_limits<std::size_t>::max();
+
+        struct Node {
+            GameObject * go = nullptr;
+            GameObject * parent = nullptr;
+            std::size_t parentIndex = NO_PARENT; // Only set if the parent is a child itself
+            std::size_t end = 0; // Index following the node's subtree
+            LocalTransform local = {};
+            bool localChanged = false;
+            bool moved = false; // Set during update
+        };
+
+        // Nodes in [begin, end) must form whole subtrees
+        void updateRange(std::size_t begin, std::size_t end) {
+            for (auto i = begin; i < end; ++i) {
+                auto & node = _nodes[i];
+                node.moved = false;
+                if (!node.go->hasComponent<TransformComponent3d>())
+                    continue;
+
+                const auto & child = getTransform(*node.go);
+                const bool written = child.getChangeTick() > _lastUpdate;
+
+                if (!node.parent->hasComponent<TransformComponent3d>()) { // Treated as a root
+                    node.moved = written;
+                    continue;
+                }
+
+                // A parent outside of the range wasn't moved by this update, but may have been written to directly
+                const auto & parent = getTransform(*node.parent);
+                const bool parentMoved = node.parentIndex != NO_PARENT && node.parentIndex >= begin ?
+                                         _nodes[node.parentIndex].moved :
+                                         parent.getChangeTick() > _lastUpdate;
+
+                if (parentMoved || node.localChanged)
+                    toWorld(parent, node.local, node.go->getComponent<TransformComponent3d>());
+                else if (written)
+                    node.local = toLocal(parent, child);
+
+                node.moved = parentMoved || node.localChanged || written;
+                node.localChanged = false;
+            }
+        }
+
+        // Registered as the listener for TransformComponent3d, see detail::changeListener
+        static void onTransformChanged(IComponent & comp) {
+            const auto go = comp._owner;
+            if (go != nullptr && go->_hierarchy != nullptr)
+                go->_hierarchy->markMoved(*go);
+        }
+
+        void markMoved(const GameObject & go) {
+            const std::lock_guard<std::mutex> lock(_movedMutex);
+            _moved.push_back(&go);
+        }
+
+        void updateLinked(GameObject & go) noexcept {
+            const bool linked = _indexes.find(&go) != _indexes.end() || _childCounts.find(&go) != _childCounts.end();
+            go._hierarchy = linked ? this : nullptr;
+        }
+
+        GameObject * getParentOrNull(const GameObject & go) const noexcept {
+            const auto it = _indexes.find(&go);
+            return it != _indexes.end() ? _nodes[it->second].parent : nullptr;
+        }
+
+        static const TransformComponent3d & getTransform(const GameObject & go) { return go.getComponent<TransformComponent3d>(); }
+
+        // Sorts nodes in depth-first order, grouped by anchor (the topmost parent of their tree)
+        void sort() {
+            std::unordered_map<const GameObject *, std::vector<std::size_t>> children;
+            for (std::size_t i = 0; i < _nodes.size(); ++i)
+                children[_nodes[i].parent].push_back(i);
+
+            std::vector<Node> sorted;
+            sorted.reserve(_nodes.size());
+            _anchors.clear();
+            for (const auto & [parent, indexes] : children) {
+                if (_indexes.find(parent) != _indexes.end())
+                    continue; // Added with its own parent's subtree
+                const auto begin = sorted.size();
+                appendChildren(parent, NO_PARENT, children, sorted);
+                _anchors[parent] = { begin, sorted.size() };
+            }
+
+            _nodes = std::move(sorted);
+            for (std::size_t i = 0; i < _nodes.size(); ++i)
+                _indexes[_nodes[i].go] = i;
+            _sorted = true;
+        }
+
+        void appendChildren(const GameObject * parent, std::size_t parentIndex,
+                            const std::unordered_map<const GameObject *, std::vector<std::size_t>> & children,
+                            std::vector<Node> & sorted) const {
+            const auto it = children.find(parent);
+            if (it == children.end())
+                return;
+
+            for (const auto index : it->second) {
+                const auto position = sorted.size();
+                sorted.push_back(_nodes[index]);
+                sorted[position].parentIndex = parentIndex;
+                appendChildren(_nodes[index].go, position, children, sorted);
+                sorted[position].end = sorted.size();
+            }
+        }
+
+    private:
+        // Rotates v by yaw around the y axis, after rotating it by pitch around the x axis
+        static putils::Point3d rotate(const putils::Point3d & v, double pitch, double yaw) noexcept {
+            const auto cosPitch = std::cos(pitch), sinPitch = std::sin(pitch);
+            const auto cosYaw = std::cos(yaw), sinYaw = std::sin(yaw);
+
+            const auto y = v.y * cosPitch - v.z * sinPitch;
+            const auto z = v.y * sinPitch + v.z * cosPitch;
+            return { v.x * cosYaw + z * sinYaw, y, -v.x * sinYaw + z * cosYaw };
+        }
+
+        // Inverse of rotate
+        static putils::Point3d unrotate(const putils::Point3d & v, double pitch, double yaw) noexcept {
+            const auto cosPitch = std::cos(pitch), sinPitch = std::sin(pitch);
+            const auto cosYaw = std::cos(yaw), sinYaw = std::sin(yaw);
+
+            const auto x = v.x * cosYaw - v.z * sinYaw;
+            const auto z = v.x * sinYaw + v.z * cosYaw;
+            return { x, v.y * cosPitch + z * sinPitch, -v.y * sinPitch + z * cosPitch };
+        }
+
+        static void toWorld(const TransformComponent3d & parent, const LocalTransform & local, TransformComponent3d & child) noexcept {
+            const auto offset = rotate(local.position, parent.pitch, parent.yaw);
+            const auto & origin = parent.boundingBox.topLeft;
+            child.boundingBox.topLeft = { origin.x + offset.x, origin.y + offset.y, origin.z + offset.z };
+            child.pitch = parent.pitch + local.pitch;
+            child.yaw = parent.yaw + local.yaw;
+        }
+
+        static LocalTransform toLocal(const TransformComponent3d & parent, const TransformComponent3d & child) noexcept {
+            const auto & origin = parent.boundingBox.topLeft;
+            const auto & pos = child.boundingBox.topLeft;
+            return LocalTransform{
+                    unrotate({ pos.x - origin.x, pos.y - origin.y, pos.z - origin.z }, parent.pitch, parent.yaw),
+                    child.pitch - parent.pitch,
+                    child.yaw - parent.yaw
+            };
+        }
+
+    private:
+        std::vector<Node> _nodes; // In depth-first order once _sorted is set
+        std::unordered_map<const GameObject *, std::size_t> _indexes; // Position in _nodes
+        std::unordered_map<const GameObject *, std::size_t> _childCounts; // Only for GameObjects with children
+        // Range in _nodes of the trees under each parent that isn't a child itself, set by sort
+        std::unordered_map<const GameObject *, std::pair<std::size_t, std::size_t>> _anchors;
+        bool _sorted = true;
+        std::uint64_t _lastUpdate = 0; // Change tick of the last update
+
+        // GameObjects whose transform changed, or whose local transform was set, since the last update
+        std::vector<const GameObject *> _moved;
+        std::mutex _movedMutex;
+    };
+}
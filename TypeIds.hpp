@@ -0,0 +1,103 @@
+#pragma once
+
+#include <mutex>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <unordered_map>
+#include "meta/type.hpp"
+
+#ifndef KENGINE_MAX_COMPONENT_TYPES
+# define KENGINE_MAX_COMPONENT_TYPES 128
+#endif
+
+namespace kengine {
+    namespace detail {
+        // Dense ids, assigned to types the first time they are used, so that they can index small flat arrays
+        // Separate families (Components, Systems) each start at 0
+        template<typename Family>
+        std::size_t getDenseId(pmeta::type_index type) noexcept {
+            static std::mutex mutex;
+            static std::unordered_map<pmeta::type_index, std::size_t> ids;
+
+            const std::lock_guard<std::mutex> lock(mutex);
+            return ids.try_emplace(type, ids.size()).first->second;
+        }
+
+        struct ComponentIds;
+        struct SystemIds;
+
+        inline std::size_t getComponentId(pmeta::type_index type) noexcept { return getDenseId<ComponentIds>(type); }
+        inline std::size_t getSystemId(pmeta::type_index type) noexcept { return getDenseId<SystemIds>(type); }
+
+        // Only looked up once per type
+        template<typename T>
+        std::size_t componentId() noexcept {
+            static const auto id = getComponentId(pmeta::type<T>::index);
+            return id;
+        }
+
+        template<typename T>
+        std::size_t systemId() noexcept {
+            static const auto id = getSystemId(pmeta::type<T>::index);
+            return id;
+        }
+    }
+
+    // Fixed-width set of Component ids, see GameObject::getSignature
+    class ComponentSignature {
+    public:
+        static constexpr std::size_t SIZE = KENGINE_MAX_COMPONENT_TYPES;
+
+        bool test(std::size_t id) const noexcept { return id < SIZE && ((_words[id / 64] >> (id % 64)) & 1) != 0; }
+        void set(std::size_t id) noexcept { _words[id / 64] |= std::uint64_t(1) << (id % 64); }
+        void reset(std::size_t id) noexcept { _words[id / 64] &= ~(std::uint64_t(1) << (id % 64)); }
+
+        // Number of ids lower than id in the set, used to index arrays sorted by id
+        std::size_t rank(std::size_t id) const noexcept {
+            std::size_t ret = 0;
+            for (std::size_t i = 0; i < id / 64; ++i)
+                ret += popcount(_words[i]);
+            return ret + popcount(_words[id / 64] & ((std::uint64_t(1) << (id % 64)) - 1));
+        }
+
+        std::size_t count() const noexcept {
+            std::size_t ret = 0;
+            for (const auto word : _words)
+                ret += popcount(word);
+            return ret;
+        }
+
+        // Whether all the ids in other are in this
+        bool contains(const ComponentSignature & other) const noexcept {
+            for (std::size_t i = 0; i < _words.size(); ++i)
+                if ((_words[i] & other._words[i]) != other._words[i])
+                    return false;
+            return true;
+        }
+
+        bool intersects(const ComponentSignature & other) const noexcept {
+            for (std::size_t i = 0; i < _words.size(); ++i)
+                if ((_words[i] & other._words[i]) != 0)
+                    return true;
+            return false;
+        }
+
+        bool operator==(const ComponentSignature & rhs) const noexcept { return _words == rhs._words; }
+        bool operator!=(const ComponentSignature & rhs) const noexcept { return _words != rhs._words; }
+
+    private:
+        // A single popcnt instruction only when the target has one (e.g. x86 with -mpopcnt or -march=native),
+        // otherwise the compiler's fallback: a libgcc call for GCC, or a few shifts and masks
+        static std::size_t popcount(std::uint64_t x) noexcept {
+#if defined(__GNUC__) || defined(__clang__)
+            return (std::size_t)__builtin_popcountll(x);
+#else
+            return std::bitset<64>(x).count();
+#endif
+        }
+
+    private:
+        std::array<std::uint64_t, (SIZE + 63) / 64> _words{};
+    };
+}
@@ -10,7 +10,6 @@ namespace kengine {
         GUIComponent(std::string_view text = "", std::size_t textSize = 18, std::string_view font = "")
                 : text(text), textSize(textSize), font(font) {}
 
-        const std::string type = pmeta_nameof(GUIComponent);
         std::string text;
         double textSize = 12;
         std::string font;
@@ -24,7 +23,6 @@ namespace kengine {
     public:
         pmeta_get_class_name(GUIComponent);
         pmeta_get_attributes(
-                pmeta_reflectible_attribute(&GUIComponent::type),
                 pmeta_reflectible_attribute(&GUIComponent::text),
                 pmeta_reflectible_attribute(&GUIComponent::textSize),
                 pmeta_reflectible_attribute(&GUIComponent::font),
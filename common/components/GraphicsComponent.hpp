@@ -11,7 +11,6 @@ namespace kengine {
         GraphicsComponent(std::string_view appearance = "")
                 : appearance(appearance) {}
 
-        const std::string type = pmeta_nameof(GraphicsComponent);
         std::string appearance;
         putils::Point3d size;
         double yaw = 0;
@@ -24,7 +23,6 @@ namespace kengine {
     public:
         pmeta_get_class_name(GraphicsComponent);
         pmeta_get_attributes(
-                pmeta_reflectible_attribute(&GraphicsComponent::type),
                 pmeta_reflectible_attribute(&GraphicsComponent::appearance),
                 pmeta_reflectible_attribute(&GraphicsComponent::size),
                 pmeta_reflectible_attribute(&GraphicsComponent::yaw),
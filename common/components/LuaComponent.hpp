@@ -27,7 +27,6 @@ namespace kengine {
         const std::vector<std::string> & getScripts() const noexcept { return _scripts; }
 
     private:
-        const std::string type = pmeta_nameof(LuaComponent);
         std::vector<std::string> _scripts;
 
         /*
@@ -36,7 +35,6 @@ namespace kengine {
     public:
         pmeta_get_class_name(LuaComponent);
         pmeta_get_attributes(
-                pmeta_reflectible_attribute(&LuaComponent::type),
                 pmeta_reflectible_attribute_private(&LuaComponent::_scripts),
                 pmeta_reflectible_attribute(&LuaComponent::meta)
         );
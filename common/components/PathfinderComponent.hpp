@@ -6,7 +6,6 @@
 namespace kengine {
     class PathfinderComponent : public kengine::SerializableComponent<PathfinderComponent> {
     public:
-        const std::string type = pmeta_nameof(PathfinderComponent);
         putils::Point3d dest;
         bool reached = true;
         bool diagonals = true;
@@ -19,7 +18,6 @@ namespace kengine {
     public:
         pmeta_get_class_name(PathfinderComponent);
         pmeta_get_attributes(
-                pmeta_reflectible_attribute(&PathfinderComponent::type),
                 pmeta_reflectible_attribute(&PathfinderComponent::dest),
                 pmeta_reflectible_attribute(&PathfinderComponent::reached),
                 pmeta_reflectible_attribute(&PathfinderComponent::diagonals),
@@ -11,7 +11,6 @@ namespace kengine {
                 : solid(solid), fixed(false) {}
 
     public:
-        const std::string type = pmeta_nameof(PhysicsComponent);
         bool solid = true;
         bool fixed = false;
         putils::Point3d movement;
@@ -24,7 +23,6 @@ namespace kengine {
     public:
         pmeta_get_class_name(PhysicsComponent);
         pmeta_get_attributes(
-                pmeta_reflectible_attribute(&PhysicsComponent::type),
                 pmeta_reflectible_attribute(&PhysicsComponent::solid),
                 pmeta_reflectible_attribute(&PhysicsComponent::fixed),
                 pmeta_reflectible_attribute(&PhysicsComponent::movement),
@@ -22,7 +22,6 @@ namespace kengine {
         const std::vector<std::string> & getScripts() const noexcept { return _scripts; }
 
     private:
-        const std::string type = pmeta_nameof(PyComponent);
         std::vector<std::string> _scripts;
 
         /*
@@ -31,7 +30,6 @@ namespace kengine {
     public:
         pmeta_get_class_name(PyComponent);
         pmeta_get_attributes(
-                pmeta_reflectible_attribute(&PyComponent::type),
                 pmeta_reflectible_attribute_private(&PyComponent::_scripts)
         );
         pmeta_get_methods(
@@ -20,7 +20,6 @@ namespace kengine {
         TransformComponent(const putils::Rect<Precision, Dimensions> & rect)
                 : boundingBox(rect) {}
 
-        const std::string type = pmeta_nameof(TransformComponent);
         putils::Rect<Precision, Dimensions> boundingBox;
         Precision pitch = 0; // Radians
         Precision yaw = 0; // Radians
@@ -32,7 +31,6 @@ namespace kengine {
     public:
         pmeta_get_class_name(TransformComponent);
         pmeta_get_attributes(
-                pmeta_reflectible_attribute(&TransformComponent::type),
                 pmeta_reflectible_attribute(&TransformComponent::boundingBox),
                 pmeta_reflectible_attribute(&TransformComponent::pitch),
                 pmeta_reflectible_attribute(&TransformComponent::yaw)
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <cstddef>
+
+namespace kengine {
+    namespace packets {
+        // All the Ps sent with SystemManager::sendDeferred by one thread since the last sync point, see DeferredChannel
+        template<typename P>
+        struct Batch {
+            const P * data;
+            std::size_t size;
+
+            const P * begin() const noexcept { return data; }
+            const P * end() const noexcept { return data + size; }
+        };
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace kengine {
+    class GameObject;
+
+    namespace packets {
+        // go keeps its Components, but no longer appears in getGameObjects or forEach until it is enabled again
+        struct DisableGameObject {
+            GameObject & go;
+        };
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+namespace kengine {
+    class GameObject;
+
+    namespace packets {
+        // Sent when a GameObject disabled with EntityManager::disableEntity is enabled again
+        struct EnableGameObject {
+            GameObject & go;
+        };
+    }
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+#include <string>
+
+namespace kengine {
+    namespace packets {
+        // Sent by the EntityManager once a call to loadAsync is complete
+        struct LoadCompleted {
+            std::string file;
+            bool success;
+        };
+    }
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "MemoryStats.hpp"
+#include "putils/reflection/Reflectible.hpp"
+
+namespace kengine {
+    namespace packets {
+        // Periodically sent by the EntityManager, see EntityManager::setMemoryReportInterval
+        struct MemoryReport {
+            kengine::MemoryStats stats;
+
+            /*
+             * Reflectible
+             */
+
+            pmeta_get_class_name(MemoryReport);
+            pmeta_get_attributes(
+                    pmeta_reflectible_attribute(&MemoryReport::stats)
+            );
+            pmeta_get_methods();
+            pmeta_get_parents();
+        };
+    }
+}
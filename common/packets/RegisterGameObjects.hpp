@@ -0,0 +1,14 @@
+#pragma once
+
+#include <vector>
+
+namespace kengine {
+    class GameObject;
+
+    namespace packets {
+        // Sent once per frame with all the GameObjects added since the previous one, see SystemManager::registerGameObjects
+        struct RegisterGameObjects {
+            const std::vector<GameObject *> & gameObjects;
+        };
+    }
+}
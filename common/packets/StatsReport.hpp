@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+#include "SystemStats.hpp"
+#include "putils/reflection/Reflectible.hpp"
+
+namespace kengine {
+    namespace packets {
+        // Periodically sent by the SystemManager, see SystemManager::setStatsReportInterval
+        struct StatsReport {
+            std::vector<kengine::SystemStats> systems;
+
+            /*
+             * Reflectible
+             */
+
+            pmeta_get_class_name(StatsReport);
+            pmeta_get_attributes(
+                    pmeta_reflectible_attribute(&StatsReport::systems)
+            );
+            pmeta_get_methods();
+            pmeta_get_parents();
+        };
+    }
+}
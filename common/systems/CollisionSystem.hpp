@@ -5,14 +5,17 @@
 #include "components/CollisionComponent.hpp"
 
 namespace kengine {
-	class CollisionSystem : public System<CollisionSystem, packets::Collision> {
+	class CollisionSystem : public System<CollisionSystem, packets::Batch<packets::Collision>> {
 	public:
 		CollisionSystem(kengine::EntityManager &) {}
 
 	public:
-		void handle(const kengine::packets::Collision & p) {
-			trigger(p.first, p.second);
-			trigger(p.second, p.first);
+		// Collisions are sent with sendDeferred, so callbacks aren't called while the PhysicsSystem is iterating
+		void handle(const kengine::packets::Batch<kengine::packets::Collision> & collisions) {
+			for (const auto & p : collisions) {
+				trigger(p.first, p.second);
+				trigger(p.second, p.first);
+			}
 		}
 
 	private:
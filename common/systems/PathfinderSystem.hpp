@@ -11,20 +11,23 @@
 namespace kengine {
     class PathfinderSystem : public kengine::System<PathfinderSystem> {
     public:
-        PathfinderSystem(kengine::EntityManager & em) : putils::BaseModule(&em), _em(em) {}
+        PathfinderSystem(kengine::EntityManager & em) : putils::BaseModule(&em), _em(em) {
+            reads<kengine::TransformComponent3d>();
+            writes<kengine::PathfinderComponent, kengine::PhysicsComponent>();
+            sends<kengine::packets::Position::Query>();
+        }
 
     public:
         void execute() noexcept final {
-            for (const auto go : _em.getGameObjects<kengine::PathfinderComponent>()) {
-                auto & comp = go->getComponent<kengine::PathfinderComponent>();
+            for (const auto & [go, comp, phys, transform] : _em.getGameObjects<kengine::PathfinderComponent, kengine::PhysicsComponent, const kengine::TransformComponent3d>()) {
                 if (comp.reached)
                     continue;
 
-                moveTowards(*go, comp);
+                moveTowards(go, comp);
 
-                if (reached(*go, comp.dest, comp.desiredDistance)) {
+                if (reached(go, comp.dest, comp.desiredDistance)) {
                     comp.reached = true;
-                    go->getComponent<kengine::PhysicsComponent>().movement = { 0, 0, 0 };
+                    phys.movement = { 0, 0, 0 };
                 }
             }
         }
@@ -36,7 +39,7 @@ namespace kengine {
 
         void moveTowards(kengine::GameObject & go, const PathfinderComponent & comp) {
             auto & phys = go.getComponent<kengine::PhysicsComponent>();
-            const auto & box = go.getComponent<kengine::TransformComponent3d>().boundingBox;
+            const auto & box = static_cast<const kengine::GameObject &>(go).getComponent<kengine::TransformComponent3d>().boundingBox;
 
             const putils::Point2d start { box.topLeft.x, box.topLeft.z };
             const putils::Point2d end { comp.dest.x, comp.dest.z };
@@ -87,7 +90,7 @@ namespace kengine {
             return std::any_of(
                     objects.begin(), objects.end(),
                     [&go, &boundingBox](kengine::GameObject * other) {
-                        const auto & otherBox = other->getComponent<kengine::TransformComponent3d>().boundingBox;
+                        const auto & otherBox = static_cast<const kengine::GameObject &>(*other).getComponent<kengine::TransformComponent3d>().boundingBox;
                         return &go != other && otherBox.intersect(boundingBox);
                     }
             );
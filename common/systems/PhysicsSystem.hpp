@@ -14,35 +14,33 @@ namespace kengine {
 
     public:
         void execute() final {
-            for (const auto go : _em.getGameObjects<PhysicsComponent>())
-                updatePosition(*go);
+            // Transforms are only obtained mutably (and marked as changed) for GameObjects that move
+            for (const auto & [go, phys, transform] : _em.getGameObjects<const PhysicsComponent, const TransformComponent3d>())
+                updatePosition(go, phys, transform.boundingBox);
         }
 
     public:
         void handle(const packets::Position::Query & q) {
             std::vector<kengine::GameObject *> found;
 
-            for (const auto go : _em.getGameObjects<kengine::PhysicsComponent>()) {
-                auto & box = go->getComponent<kengine::TransformComponent3d>().boundingBox;
-                if (box.intersect(q.box))
-                    found.push_back(go);
-            }
+            for (const auto & [go, phys, transform] : _em.getGameObjects<const kengine::PhysicsComponent, const kengine::TransformComponent3d>())
+                if (transform.boundingBox.intersect(q.box))
+                    found.push_back(&go);
 
             sendTo( packets::Position::Response { found }, *q.sender);
         }
 
         // Helpers
     private:
-        void updatePosition(kengine::GameObject & go) {
-            const auto & phys = go.getComponent<PhysicsComponent>();
+        void updatePosition(kengine::GameObject & go, const PhysicsComponent & phys, const putils::Rect3d & current) {
             if (phys.fixed)
                 return;
 
-            auto & box = go.getComponent<kengine::TransformComponent3d>().boundingBox;
-
-            const auto dest = getNewPos(box.topLeft, phys.movement, phys.speed);
-            if (dest == box.topLeft)
+            const auto dest = getNewPos(current.topLeft, phys.movement, phys.speed);
+            if (dest == current.topLeft)
                 return;
+
+            auto & box = go.getComponent<TransformComponent3d>().boundingBox;
             box.topLeft = dest;
 
             if (phys.solid)
@@ -58,13 +56,12 @@ namespace kengine {
         }
 
         void checkCollisions(kengine::GameObject & go, const putils::Rect3d & box) {
-            for (const auto obj : _em.getGameObjects<kengine::PhysicsComponent>()) {
-                if (obj == &go)
+            for (const auto & [obj, phys, transform] : _em.getGameObjects<const kengine::PhysicsComponent, const kengine::TransformComponent3d>()) {
+                if (&obj == &go)
                     continue;
 
-                const auto & other = obj->getComponent<kengine::TransformComponent3d>().boundingBox;
-                if (box.intersect(other))
-                    send(kengine::packets::Collision{ go, *obj });
+                if (box.intersect(transform.boundingBox))
+                    _em.sendDeferred(kengine::packets::Collision{ go, obj });
             }
         }
 
@@ -26,28 +26,31 @@ namespace kengine {
     }
 
     void Box2DSystem::execute() noexcept {
-        for (const auto go : _em.getGameObjects<Box2DComponent>())
-            updateBody(*go);
+        // Velocities are set every frame, as contacts alter them during the step
+        for (const auto & [go, comp, phys] : _em.getGameObjects<const Box2DComponent, const PhysicsComponent>())
+            updateVelocity(comp, phys);
+
+        // Bodies are only moved and resized when their transform was changed by someone else
+        for (const auto & [go, comp, transform] : _em.getGameObjects<const Box2DComponent, Changed<const TransformComponent3d>>())
+            updateBody(comp, transform);
 
         _world.Step((float)time.getDeltaFrames(), VELOCITY_ITERATIONS, POSITION_ITERATIONS);
 
-        for (const auto go : _em.getGameObjects<Box2DComponent>())
-            updateTransform(*go);
+        for (const auto & [go, comp, transform] : _em.getGameObjects<const Box2DComponent, const TransformComponent3d>())
+            updateTransform(go, comp, transform);
 
         handleCollisions();
     }
 
-    void Box2DSystem::updateBody(kengine::GameObject & go) noexcept {
-        const auto & phys = go.getComponent<PhysicsComponent>();
-        auto & comp = go.getComponent<Box2DComponent>();
+    void Box2DSystem::updateVelocity(const Box2DComponent & comp, const PhysicsComponent & phys) noexcept {
         comp.body->SetLinearVelocity(
                 { (float)(phys.movement.x * phys.speed), (float)(phys.movement.z * phys.speed) }
         );
+    }
 
-        const auto & transform = go.getComponent<TransformComponent3d>();
+    void Box2DSystem::updateBody(const Box2DComponent & comp, const TransformComponent3d & transform) noexcept {
         const auto & box = transform.boundingBox;
         const auto & pos = box.topLeft;
-        const auto & size = box.size;
         comp.body->SetTransform({ (float)pos.x, (float)pos.z }, (float)transform.yaw);
 
         comp.body->DestroyFixture(comp.body->GetFixtureList());
@@ -62,17 +65,21 @@ namespace kengine {
         comp.body->CreateFixture(&fixtureDef);
     }
 
-    void Box2DSystem::updateTransform(kengine::GameObject & go) noexcept {
-        const auto & comp = go.getComponent<Box2DComponent>();
-        auto & box = go.getComponent<kengine::TransformComponent3d>().boundingBox;
+    // Bodies that didn't move leave their transform untouched, so it isn't marked as changed
+    void Box2DSystem::updateTransform(GameObject & go, const Box2DComponent & comp, const TransformComponent3d & transform) noexcept {
         const auto & position = comp.body->GetPosition();
+        const auto & topLeft = transform.boundingBox.topLeft;
+        if (topLeft.x == position.x && topLeft.z == position.y)
+            return;
+
+        auto & box = go.getComponent<TransformComponent3d>().boundingBox;
         box.topLeft.x = position.x;
         box.topLeft.z = position.y;
     }
 
     void Box2DSystem::handleCollisions() noexcept {
         for (const auto & p : contacts)
-            send(kengine::packets::Collision{ *p.first, *p.second });
+            _em.sendDeferred(kengine::packets::Collision{ *p.first, *p.second });
         contacts.clear();
     }
 
@@ -81,10 +88,14 @@ namespace kengine {
         if (!go.hasComponent<kengine::TransformComponent3d>() || !go.hasComponent<kengine::PhysicsComponent>())
             return;
 
-        const auto & box = go.getComponent<kengine::TransformComponent3d>().boundingBox;
+        const auto & transform = static_cast<const kengine::GameObject &>(go).getComponent<kengine::TransformComponent3d>();
+        const auto & box = transform.boundingBox;
 
+        // Placed here, as execute only moves bodies whose transform changed
         b2::BodyDef bodyDef;
         bodyDef.type = b2::dynamicBody;
+        bodyDef.position.Set((float)box.topLeft.x, (float)box.topLeft.z);
+        bodyDef.angle = (float)transform.yaw;
         bodyDef.userData = &go;
 
         const auto body = _world.CreateBody(&bodyDef);
@@ -106,6 +117,19 @@ namespace kengine {
             _world.DestroyBody(go.getComponent<Box2DComponent>().body);
     }
 
+    // Disabled bodies stay in the world, but don't collide and aren't simulated
+    void Box2DSystem::handle(const kengine::packets::EnableGameObject & p) noexcept  {
+        auto & go = p.go;
+        if (go.hasComponent<Box2DComponent>())
+            go.getComponent<Box2DComponent>().body->SetActive(true);
+    }
+
+    void Box2DSystem::handle(const kengine::packets::DisableGameObject & p) noexcept  {
+        auto & go = p.go;
+        if (go.hasComponent<Box2DComponent>())
+            go.getComponent<Box2DComponent>().body->SetActive(false);
+    }
+
     void Box2DSystem::handle(const packets::Position::Query & q) noexcept  {
         struct Callback : public b2::QueryCallback {
             bool ReportFixture(b2::Fixture * fixture) noexcept final {
@@ -3,11 +3,15 @@
 #include "EntityManager.hpp"
 #include "System.hpp"
 #include "common/packets/Position.hpp"
+#include "common/components/PhysicsComponent.hpp"
+#include "common/components/TransformComponent.hpp"
+#include "Box2DComponent.hpp"
 #include "Box2D/Box2D.hpp"
 
 namespace kengine {
     class Box2DSystem : public kengine::System<Box2DSystem,
             kengine::packets::RegisterGameObject, kengine::packets::RemoveGameObject,
+            kengine::packets::EnableGameObject, kengine::packets::DisableGameObject,
             packets::Position::Query> {
     public:
         Box2DSystem(kengine::EntityManager & em);
@@ -16,14 +20,17 @@ namespace kengine {
         void execute() noexcept final;
         void handle(const kengine::packets::RegisterGameObject & p) noexcept;
         void handle(const kengine::packets::RemoveGameObject & p) noexcept;
+        void handle(const kengine::packets::EnableGameObject & p) noexcept;
+        void handle(const kengine::packets::DisableGameObject & p) noexcept;
 
     public:
         void handle(const packets::Position::Query & q) noexcept;
 
         // Helpers
     private:
-        void updateBody(kengine::GameObject & go) noexcept;
-        void updateTransform(kengine::GameObject & go) noexcept;
+        void updateVelocity(const Box2DComponent & comp, const PhysicsComponent & phys) noexcept;
+        void updateBody(const Box2DComponent & comp, const TransformComponent3d & transform) noexcept;
+        void updateTransform(GameObject & go, const Box2DComponent & comp, const TransformComponent3d & transform) noexcept;
         void handleCollisions() noexcept;
 
     private:
@@ -20,6 +20,14 @@ EXPORT kengine::ISystem *getSystem(kengine::EntityManager &em)
     return new OgreSystem(em);
 }
 
+// Ogre needs unique names, nameless GameObjects are identified by their handle
+static std::string getOgreName(const kengine::GameObject &go)
+{
+    if (!go.getName().empty())
+        return go.getName();
+    return putils::concat(go.getHandle());
+}
+
 OgreSystem::OgreSystem(kengine::EntityManager &em)
         : putils::BaseModule(&em), _em(em)
 {
@@ -28,6 +36,7 @@ OgreSystem::OgreSystem(kengine::EntityManager &em)
                 _app.reset(new pogre::App("kengine"));
                 _app->start();
                 getMediator()->running = false;
+                _em.wakeUp();
             }
     );
     while (!_app);
@@ -93,11 +102,12 @@ void OgreSystem::execute()
     // Update text
     for (const auto go : _em.getGameObjects<OgreTextComponent>())
     {
+        const auto &reader = static_cast<const kengine::GameObject &>(*go);
         auto &comp = go->getComponent<OgreTextComponent>();
-        const auto &pos = go->getComponent<kengine::TransformComponent3d>().boundingBox.topLeft;
+        const auto &pos = reader.getComponent<kengine::TransformComponent3d>().boundingBox.topLeft;
         _toMove.emplace_back(
                 go,
-                [this, pos, text = go->getComponent<kengine::GUIComponent>().text, &comp]
+                [this, pos, text = reader.getComponent<kengine::GUIComponent>().text, &comp]
                 {
                     comp.setPosition(pos);
                     comp.setText(text);
@@ -108,7 +118,7 @@ void OgreSystem::execute()
     // Update cameras
     for (const auto go : _em.getGameObjects<OgreCameraComponent>())
     {
-        const auto &cam = go->getComponent<kengine::CameraComponent3d>();
+        const auto &cam = static_cast<const kengine::GameObject &>(*go).getComponent<kengine::CameraComponent3d>();
         const auto &pos = cam.frustrum.topLeft;
 
         auto &comp = go->getComponent<OgreCameraComponent>();
@@ -124,30 +134,24 @@ void OgreSystem::execute()
         );
     }
 
-    // Update lights
-    for (const auto go : _em.getGameObjects<OgreLightComponent>())
+    // Update lights and entities, whose Ogre objects are placed when created, so only once their transform changes
+    for (const auto & [go, light, transform] : _em.getGameObjects<OgreLightComponent, kengine::Changed<const kengine::TransformComponent3d>>())
     {
-        const auto &transform = go->getComponent<kengine::TransformComponent3d>();
         const auto &pos = transform.boundingBox.topLeft;
-
-        auto &comp = go->getComponent<OgreLightComponent>();
         _toMove.emplace_back(
-                go,
-                [this, &comp, pos] { comp.setPosition(pos); }
+                &go,
+                [this, &comp = light, pos] { comp.setPosition(pos); }
         );
     }
 
-    // Update entities
-    for (const auto go : _em.getGameObjects<OgreComponent>())
+    for (const auto & [go, entity, transform] : _em.getGameObjects<OgreComponent, kengine::Changed<const kengine::TransformComponent3d>>())
     {
-        const auto &transform = go->getComponent<kengine::TransformComponent3d>();
         const auto &pos = transform.boundingBox.topLeft;
         const auto &size = transform.boundingBox.size;
 
-        auto &comp = go->getComponent<OgreComponent>();
         _toMove.emplace_back(
-                go,
-                [this, &comp, pos, height = size.y, pitch = transform.pitch, yaw = transform.yaw]
+                &go,
+                [this, &comp = entity, pos, height = size.y, pitch = transform.pitch, yaw = transform.yaw]
                 {
                     comp.setHeight(height);
                     comp.setPos(pos);
@@ -223,7 +227,7 @@ void OgreSystem::removeGameObject(kengine::GameObject &go)
     if (go.hasComponent<OgreCameraComponent>()) // Remove camera
     {
         auto &comp = go.getComponent<OgreCameraComponent>();
-        _app->addAction([this, name = go.getName()] { _app->removeCamera(name); });
+        _app->addAction([this, name = getOgreName(go)] { _app->removeCamera(name); });
         go.detachComponent(comp);
     }
     if (go.hasComponent<OgreLightComponent>()) // Remove light
@@ -284,9 +288,11 @@ void OgreSystem::createEntity(kengine::GameObject &go) noexcept
             [this, &go, e, node]
             {
                 auto &comp = go.attachComponent<OgreComponent>(*e, *node, *_app);
-                const auto &transform = go.getComponent<kengine::TransformComponent3d>();
+                const auto &transform = static_cast<const kengine::GameObject &>(go).getComponent<kengine::TransformComponent3d>();
                 comp.setWidth(transform.boundingBox.size.x);
+                comp.setHeight(transform.boundingBox.size.y);
                 comp.setPos(transform.boundingBox.topLeft);
+                comp.setOrientation(transform.pitch, transform.yaw);
             }
     );
 }
@@ -294,7 +300,7 @@ void OgreSystem::createEntity(kengine::GameObject &go) noexcept
 void OgreSystem::createCamera(kengine::GameObject &go) noexcept
 {
     auto &cam = _app->addCamera(
-            go.getName(),
+            getOgreName(go),
             pogre::CameraMan(*_scnMgr, *_app->getRenderWindow(),
                              std::make_unique<pogre::FreeFloatingStrategy>()
             )
@@ -318,7 +324,7 @@ void OgreSystem::createLight(kengine::GameObject &go) noexcept
     auto pointLight = _scnMgr->createLight();
     pointLight->setType(Ogre::Light::LT_POINT);
 
-    const auto &transform = go.getComponent<kengine::TransformComponent3d>();
+    const auto &transform = static_cast<const kengine::GameObject &>(go).getComponent<kengine::TransformComponent3d>();
     const auto &pos = transform.boundingBox.topLeft;
     pointLight->setPosition((float)pos.x, (float)pos.y, (float)pos.z);
 
@@ -327,9 +333,9 @@ void OgreSystem::createLight(kengine::GameObject &go) noexcept
 
 void OgreSystem::createText(kengine::GameObject &go) noexcept
 {
-    const auto &gui = go.getComponent<kengine::GUIComponent>();
+    const auto &gui = static_cast<const kengine::GameObject &>(go).getComponent<kengine::GUIComponent>();
 
-    auto text = new Ogre::MovableText(go.getName(), gui.text);
+    auto text = new Ogre::MovableText(getOgreName(go), gui.text);
     text->setTextAlignment(Ogre::MovableText::H_CENTER, Ogre::MovableText::V_CENTER);
     text->setCharacterHeight(gui.textSize);
     text->setFontName("StarWars");
@@ -343,7 +349,7 @@ void OgreSystem::createText(kengine::GameObject &go) noexcept
             [this, &go, text, node]
             {
                 auto &comp = go.attachComponent<OgreTextComponent>(*text, *node);
-                const auto &transform = go.getComponent<kengine::TransformComponent3d>();
+                const auto &transform = static_cast<const kengine::GameObject &>(go).getComponent<kengine::TransformComponent3d>();
                 comp.setPosition(transform.boundingBox.topLeft);
             }
     );
@@ -1,3 +1,4 @@
+#include <algorithm>
 #include "SfSystem.hpp"
 
 #include "EntityManager.hpp"
@@ -19,6 +20,13 @@ EXPORT kengine::ISystem * getSystem(kengine::EntityManager & em) {
 }
 
 namespace kengine {
+    // Nameless GameObjects are identified by their handle
+    static std::string getViewName(const kengine::GameObject & go) {
+        if (!go.getName().empty())
+            return go.getName();
+        return putils::concat(go.getHandle());
+    }
+
     /*
      * Constructor
      */
@@ -119,43 +127,52 @@ namespace kengine {
             _engine.removeView("default");
 
         for (const auto go : cameras) {
-            auto & view = _engine.getView(go->getName());
+            auto & view = _engine.getView(getViewName(*go));
 
-            const auto & frustrum = go->getComponent<kengine::CameraComponent3d>().frustrum;
+            const auto & frustrum = static_cast<const kengine::GameObject &>(*go).getComponent<kengine::CameraComponent3d>().frustrum;
             view.setCenter(
                     (float)(frustrum.topLeft.x + frustrum.size.x / 2) * _tileSize.x,
                     (float)(frustrum.topLeft.z + frustrum.size.z / 2) * _tileSize.y
             );
             view.setSize((float)frustrum.size.x * _tileSize.x, (float)frustrum.size.z * _tileSize.y);
 
-            const auto & box = go->getComponent<kengine::TransformComponent3d>().boundingBox;
+            const auto & box = static_cast<const kengine::GameObject &>(*go).getComponent<kengine::TransformComponent3d>().boundingBox;
             view.setViewport(sf::FloatRect{
                     (float)box.topLeft.x, (float)box.topLeft.z,
                     (float)box.size.x, (float)box.size.z
             });
-            _engine.setViewHeight(go->getName(), (size_t)box.topLeft.y);
+            _engine.setViewHeight(getViewName(*go), (size_t)box.topLeft.y);
         }
     }
 
     void SfSystem::updateDrawables() {
-        std::vector<kengine::GameObject *> toDetach;
-
-        for (const auto go : _em.getGameObjects<SfComponent>()) {
-            auto & comp = go->getComponent<SfComponent>();
+        // GUI elements follow their camera, so they're updated every frame
+        for (const auto & [go, comp, gui] : _em.getGameObjects<SfComponent, const kengine::GUIComponent>())
+            updateGUIElement(go, comp);
+
+        // Other objects are only synced when their transform, appearance or SfComponent changed
+        std::vector<kengine::GameObject *> toUpdate;
+        const auto collect = [&toUpdate](const auto & view) {
+            toUpdate.insert(toUpdate.end(), view.getGameObjects().begin(), view.getGameObjects().end());
+        };
+        collect(_em.getGameObjects<Changed<const kengine::TransformComponent3d>, const SfComponent, const kengine::GraphicsComponent, Without<kengine::GUIComponent>>());
+        collect(_em.getGameObjects<Changed<const kengine::GraphicsComponent>, const SfComponent, const kengine::TransformComponent3d, Without<kengine::GUIComponent>>());
+        collect(_em.getGameObjects<Changed<const SfComponent>, const kengine::TransformComponent3d, const kengine::GraphicsComponent, Without<kengine::GUIComponent>>());
+        std::sort(toUpdate.begin(), toUpdate.end());
+        toUpdate.erase(std::unique(toUpdate.begin(), toUpdate.end()), toUpdate.end());
+
+        for (const auto go : toUpdate)
+            updateObject(*go, go->getComponent<SfComponent>());
 
-            if (go->hasComponent<kengine::GUIComponent>())
-                updateGUIElement(*go, comp);
-            else if (go->hasComponent<kengine::GraphicsComponent>())
-                updateObject(*go, comp);
-            else
-                toDetach.push_back(go);
-        }
+        std::vector<kengine::GameObject *> toDetach;
+        for (const auto & [go, comp] : _em.getGameObjects<SfComponent, Without<kengine::GUIComponent>, Without<kengine::GraphicsComponent>>())
+            toDetach.push_back(&go);
 
         for (const auto go : toDetach)
             go->detachComponent<SfComponent>();
     }
 
-    void SfSystem::updateObject(kengine::GameObject & go, SfComponent & comp) {
+    void SfSystem::updateObject(const kengine::GameObject & go, SfComponent & comp) {
         const auto & transform = go.getComponent<kengine::TransformComponent3d>();
         updateTransform(go, comp, transform);
 
@@ -194,23 +211,25 @@ namespace kengine {
     }
 
     void SfSystem::updateGUIElement(kengine::GameObject & go, SfComponent & comp) noexcept {
-        const auto & gui = go.getComponent<kengine::GUIComponent>();
+        const auto & reader = static_cast<const kengine::GameObject &>(go);
+        const auto & gui = reader.getComponent<kengine::GUIComponent>();
         auto & view = static_cast<pse::Text &>(comp.getViewItem());
         view.setString(gui.text);
 
-        auto & transform = go.getComponent<kengine::TransformComponent3d>();
+        // Only GUI elements attached to a camera move, the others' transforms are read without being marked as changed
         if (!gui.camera.empty()) {
 			const auto & cam = _em.getEntity(gui.camera);
-            const auto & frustrum = cam.getComponent<kengine::CameraComponent3d>().frustrum;
+            const auto & frustrum = static_cast<const kengine::GameObject &>(cam).getComponent<kengine::CameraComponent3d>().frustrum;
+            auto & transform = go.getComponent<kengine::TransformComponent3d>();
             transform.boundingBox.topLeft.x = frustrum.topLeft.x + frustrum.size.x * gui.topLeft.x;
             transform.boundingBox.topLeft.z = frustrum.topLeft.z + frustrum.size.z * gui.topLeft.z;
             transform.boundingBox.topLeft.y = gui.topLeft.y;
         }
 
-        updateTransform(go, comp, transform);
+        updateTransform(go, comp, reader.getComponent<kengine::TransformComponent3d>());
     }
 
-    void SfSystem::updateTransform(kengine::GameObject & go, SfComponent & comp, const kengine::TransformComponent3d & transform) noexcept {
+    void SfSystem::updateTransform(const kengine::GameObject & go, SfComponent & comp, const kengine::TransformComponent3d & transform) noexcept {
         const auto & pos = transform.boundingBox.topLeft;
         comp.getViewItem().setPosition(
                 { (float) (_tileSize.x * pos.x), (float) (_tileSize.y * pos.z) }
@@ -272,7 +291,7 @@ namespace kengine {
             auto & v = go.hasComponent<SfComponent>() ? go.getComponent<SfComponent>()
                                                       : getResource(go);
 
-            const auto & transform = go.getComponent<kengine::TransformComponent3d>();
+            const auto & transform = static_cast<const kengine::GameObject &>(go).getComponent<kengine::TransformComponent3d>();
 
             const auto & pos = transform.boundingBox.topLeft;
             v.getViewItem().setPosition(
@@ -296,10 +315,30 @@ namespace kengine {
     }
 
     void SfSystem::handle(const kengine::packets::RemoveGameObject & p) {
+        if (p.go.isEnabled()) // Otherwise, already removed from the engine when it was disabled
+            handle(kengine::packets::DisableGameObject{ p.go });
+    }
+
+    // The view item is kept in the SfComponent, so it only has to be added back
+    void SfSystem::handle(const kengine::packets::EnableGameObject & p) {
+        auto & go = p.go;
+        if (!go.hasComponent<SfComponent>()) {
+            handle(kengine::packets::RegisterGameObject{ go });
+            return;
+        }
+        if (!go.hasComponent<kengine::TransformComponent3d>())
+            return;
+
+        auto & comp = go.getComponent<SfComponent>();
+        const auto & pos = static_cast<const kengine::GameObject &>(go).getComponent<kengine::TransformComponent3d>().boundingBox.topLeft;
+        _engine.addItem(comp.getViewItem(), (std::size_t) pos.y);
+    }
+
+    void SfSystem::handle(const kengine::packets::DisableGameObject & p) {
         auto & go = p.go;
 
-        if (go.hasComponent<kengine::CameraComponent3d>() && _engine.hasView(go.getName()))
-            _engine.removeView(go.getName());
+        if (go.hasComponent<kengine::CameraComponent3d>() && _engine.hasView(getViewName(go)))
+            _engine.removeView(getViewName(go));
 
         if (!go.hasComponent<SfComponent>())
             return;
@@ -6,6 +6,8 @@
 #include "packets/Input.hpp"
 #include "packets/RemoveGameObject.hpp"
 #include "packets/RegisterGameObject.hpp"
+#include "packets/EnableGameObject.hpp"
+#include "packets/DisableGameObject.hpp"
 
 #include "pse/Engine.hpp"
 #include "SfComponent.hpp"
@@ -15,6 +17,7 @@ namespace kengine {
 
     class SfSystem : public kengine::System<SfSystem,
             packets::RegisterGameObject, packets::RemoveGameObject,
+            packets::EnableGameObject, packets::DisableGameObject,
             packets::RegisterAppearance,
             packets::KeyStatus::Query, packets::MouseButtonStatus::Query, packets::MousePosition::Query> {
     public:
@@ -24,6 +27,8 @@ namespace kengine {
         void execute() final;
         void handle(const kengine::packets::RegisterGameObject & p);
         void handle(const kengine::packets::RemoveGameObject & p);
+        void handle(const kengine::packets::EnableGameObject & p);
+        void handle(const kengine::packets::DisableGameObject & p);
 
     public:
         void handle(const packets::RegisterAppearance & p) noexcept;
@@ -39,9 +44,9 @@ namespace kengine {
         void handleEvents() noexcept;
         void updateCameras() noexcept;
         void updateDrawables();
-        void updateObject(kengine::GameObject & go, SfComponent & comp);
+        void updateObject(const kengine::GameObject & go, SfComponent & comp);
         void updateGUIElement(kengine::GameObject & go, SfComponent & comp) noexcept;
-        void updateTransform(kengine::GameObject & go, SfComponent & comp, const kengine::TransformComponent3d & transform) noexcept;
+        void updateTransform(const kengine::GameObject & go, SfComponent & comp, const kengine::TransformComponent3d & transform) noexcept;
 
 	private:
 		putils::json::Object _config;
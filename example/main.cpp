@@ -51,7 +51,8 @@ int main(int, char ** av) {
     }
     catch (const std::out_of_range &) {} // If the LuaSystem wasn't found, ignore
 
-    // Start game
+    // Start game, sleeping between frames instead of polling the systems' timers
+    em.setSleepWhenIdle(true);
     while (em.running)
         em.execute();
 
@@ -0,0 +1,108 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "EntityManager.hpp"
+
+using namespace kengine;
+
+// Commands recorded from parallelFor and from concurrent Systems must be played back in the same order whatever the thread count
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char * what) {
+        if (!condition) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    constexpr std::size_t LOOPS = 3;
+    constexpr std::size_t ITEMS = 40;
+    constexpr std::size_t CHUNK_SIZE = 3;
+
+    // Filled in by the GameObjects' postCreate, i.e. in playback order
+    std::vector<std::string> created;
+
+    void record(CommandBuffer & commands, std::string name) {
+        commands.createEntity(name, [name](GameObject &) { created.push_back(name); });
+    }
+
+    // Records from its own thread before, between and after several parallelFor calls, on its first frame only
+    template<char Name>
+    struct Spawner : System<Spawner<Name>> {
+        Spawner(EntityManager & em) : em(em) {
+            // Declared so that both Spawners may run in the same batch
+            this->template reads<TransformComponent3d>();
+        }
+
+        std::size_t getFrameRate() const noexcept final { return 0; }
+
+        void execute() final {
+            if (done)
+                return;
+            done = true;
+
+            auto commands = em.getCommandBuffer();
+            record(commands, prefix() + "body0");
+            for (std::size_t loop = 0; loop < LOOPS; ++loop) {
+                em.parallelFor(ITEMS, CHUNK_SIZE, [this, loop](std::size_t begin, std::size_t end) {
+                    auto commands = em.getCommandBuffer();
+                    for (auto i = begin; i < end; ++i)
+                        record(commands, prefix() + "loop" + std::to_string(loop) + "_" + std::to_string(i));
+                });
+                record(commands, prefix() + "body" + std::to_string(loop + 1));
+            }
+        }
+
+        static std::string prefix() { return std::string(1, Name) + "."; }
+
+        EntityManager & em;
+        bool done = false;
+    };
+
+    // Sorted by System, then in recording order, parallelFor calls being sorted by chunk
+    std::vector<std::string> expectedOrder() {
+        std::vector<std::string> ret;
+        for (const auto prefix : { "a.", "b." }) {
+            ret.push_back(std::string(prefix) + "body0");
+            for (std::size_t loop = 0; loop < LOOPS; ++loop) {
+                for (std::size_t i = 0; i < ITEMS; ++i)
+                    ret.push_back(std::string(prefix) + "loop" + std::to_string(loop) + "_" + std::to_string(i));
+                ret.push_back(std::string(prefix) + "body" + std::to_string(loop + 1));
+            }
+        }
+        return ret;
+    }
+
+    std::vector<std::string> play(std::size_t threads) {
+        created.clear();
+
+        EntityManager em;
+        em.setThreadCount(threads);
+        em.loadSystems<Spawner<'a'>, Spawner<'b'>>();
+        em.execute();
+        em.execute();
+
+        check(em.getGameObjects().size() == expectedOrder().size(), "all the recorded GameObjects are created");
+        return created;
+    }
+
+    void sameOrderWithAnyThreadCount() {
+        const auto expected = expectedOrder();
+        check(play(1) == expected, "commands are played back by System, in recording order, with parallelFor calls sorted by chunk");
+
+        // Repeated, as a wrong order may only show up with some schedules
+        for (std::size_t run = 0; run < 20; ++run)
+            for (const std::size_t threads : { 2, 4, 8 })
+                if (play(threads) != expected) {
+                    check(false, "commands are played back in the same order with several threads");
+                    return;
+                }
+    }
+}
+
+int main() {
+    sameOrderWithAnyThreadCount();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,58 @@
+#include <chrono>
+#include <iostream>
+#include "EntityManager.hpp"
+#include "common/components/PhysicsComponent.hpp"
+#include "common/components/CollisionComponent.hpp"
+
+using namespace kengine;
+
+// Times the frame in which 100k entities, each with three Components, are removed at once
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char * what) {
+        if (!condition) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    double millisecondsSince(std::chrono::steady_clock::time_point start) {
+        const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    void removeAll(ComponentStorage storage, const char * name) {
+        constexpr std::size_t count = 100000;
+
+        EntityManager em;
+        em.setComponentStorage(storage);
+        std::vector<EntityHandle> handles;
+        handles.reserve(count);
+        for (std::size_t i = 0; i < count; ++i)
+            handles.push_back(em.createEntity<GameObject>("", [](GameObject & go) {
+                go.attachComponent<TransformComponent3d>();
+                go.attachComponent<PhysicsComponent>();
+                go.attachComponent<CollisionComponent>();
+            }).getHandle());
+        em.execute();
+        check(em.getGameObjects<TransformComponent3d>().size() == count, "all entities were added");
+
+        for (const auto handle : handles)
+            em.removeEntity(handle);
+        const auto start = std::chrono::steady_clock::now();
+        em.execute();
+        const auto elapsed = millisecondsSince(start);
+
+        check(em.getGameObjects().empty(), "all entities were removed");
+        check(em.getGameObjects<TransformComponent3d, PhysicsComponent>().empty(), "queries were emptied");
+        std::cout << "Removing " << count << " entities (" << name << "): " << elapsed << " ms" << std::endl;
+    }
+}
+
+int main() {
+    removeAll(ComponentStorage::PerEntity, "per-entity storage");
+    removeAll(ComponentStorage::Archetypes, "archetypes");
+    return failures == 0 ? 0 : 1;
+}
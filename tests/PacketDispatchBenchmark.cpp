@@ -0,0 +1,89 @@
+#include <chrono>
+#include <iostream>
+#include "EntityManager.hpp"
+
+using namespace kengine;
+
+// Compares queries sent through putils::Mediator's broadcast with the PacketDispatcher used by System::query
+// Six Systems are registered, as in a small game, and a single one answers the query
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char * what) {
+        if (!condition) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    struct Response {
+        int value = 0;
+    };
+
+    struct Query {
+        int value;
+        putils::BaseModule * sender = nullptr;
+    };
+
+    template<int I>
+    struct Unrelated {};
+
+    class Answerer : public System<Answerer, Query> {
+    public:
+        Answerer(EntityManager &) {}
+        void execute() final {}
+        void handle(const Query & q) { sendTo(Response{ q.value * 2 }, *q.sender); }
+    };
+
+    template<int I>
+    class Bystander : public System<Bystander<I>, Unrelated<I>> {
+    public:
+        Bystander(EntityManager &) {}
+        void execute() final {}
+        void handle(const Unrelated<I> &) {}
+    };
+
+    class Querier : public System<Querier> {
+    public:
+        Querier(EntityManager &) {}
+        void execute() final {}
+
+        int viaMediator(int value) { return putils::BaseModule::query<Response>(Query{ value }).value; }
+        int viaDispatcher(int value) { return query<Response>(Query{ value }).value; }
+    };
+
+    template<typename Func>
+    double nanosecondsPerCall(std::size_t calls, Func && func) {
+        const auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < calls; ++i)
+            func((int)i);
+        const std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+        return elapsed.count() / calls;
+    }
+}
+
+int main() {
+    EntityManager em;
+    em.createSystem<Bystander<0>>(em);
+    em.createSystem<Bystander<1>>(em);
+    em.createSystem<Answerer>(em);
+    em.createSystem<Bystander<2>>(em);
+    em.createSystem<Bystander<3>>(em);
+    auto & querier = em.createSystem<Querier>(em);
+    em.execute();
+
+    check(querier.viaMediator(21) == 42, "queries sent through the Mediator are answered");
+    check(querier.viaDispatcher(21) == 42, "queries sent through the PacketDispatcher are answered");
+
+    constexpr std::size_t calls = 1000000;
+    long long sum = 0;
+    const auto mediator = nanosecondsPerCall(calls, [&](int i) { sum += querier.viaMediator(i); });
+    const auto dispatcher = nanosecondsPerCall(calls, [&](int i) { sum += querier.viaDispatcher(i); });
+    check(sum == 2 * 2 * (long long)calls * (calls - 1) / 2, "every query was answered");
+
+    std::cout << "Query through putils::Mediator: " << mediator << " ns" << std::endl;
+    std::cout << "Query through PacketDispatcher: " << dispatcher << " ns" << std::endl;
+
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+#include <iostream>
+#include <cstring>
+#include <stdexcept>
+#include "EntityManager.hpp"
+#include "SerializableComponent.hpp"
+
+using namespace kengine;
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char * what) {
+        if (!condition) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    struct InventoryComponent : SerializableComponent<InventoryComponent> {
+        int gold = 0;
+        double weight = 0;
+        std::string owner;
+        std::vector<int> slots;
+        std::vector<std::string> items;
+
+        pmeta_get_class_name(InventoryComponent);
+        pmeta_get_attributes(
+                pmeta_reflectible_attribute(&InventoryComponent::gold),
+                pmeta_reflectible_attribute(&InventoryComponent::weight),
+                pmeta_reflectible_attribute(&InventoryComponent::owner),
+                pmeta_reflectible_attribute(&InventoryComponent::slots),
+                pmeta_reflectible_attribute(&InventoryComponent::items)
+        );
+    };
+
+    // Two versions of the same Component type, as saved by an older build and loaded by a newer one
+    namespace before {
+        struct StatsComponent : SerializableComponent<StatsComponent> {
+            int hp = 0;
+            std::string title;
+            float speed = 0;
+
+            pmeta_get_class_name(StatsComponent);
+            pmeta_get_attributes(
+                    pmeta_reflectible_attribute(&StatsComponent::hp),
+                    pmeta_reflectible_attribute(&StatsComponent::title),
+                    pmeta_reflectible_attribute(&StatsComponent::speed)
+            );
+        };
+    }
+
+    namespace after {
+        // title was removed
+        struct StatsComponent : SerializableComponent<StatsComponent> {
+            int hp = 0;
+            int mana = 7; // Added
+            double speed = 3; // Was a float
+
+            pmeta_get_class_name(StatsComponent);
+            pmeta_get_attributes(
+                    pmeta_reflectible_attribute(&StatsComponent::hp),
+                    pmeta_reflectible_attribute(&StatsComponent::mana),
+                    pmeta_reflectible_attribute(&StatsComponent::speed)
+            );
+        };
+    }
+
+    void roundTrip() {
+        EntityManager em;
+        em.registerCompLoader<InventoryComponent>();
+        em.registerCompLoader<TransformComponent3d>();
+
+        auto & hero = em.createEntity<GameObject>("hero");
+        auto & inventory = hero.attachComponent<InventoryComponent>();
+        inventory.gold = 42;
+        inventory.weight = 12.5;
+        inventory.owner = "a name longer than the small string buffer";
+        inventory.slots = { 1, 2, 3 };
+        inventory.items = { "sword", "", "shield" };
+        hero.attachComponent<TransformComponent3d>(putils::Point3d{ 1, 2, 3 });
+        em.createEntity<GameObject>("empty").attachComponent<TransformComponent3d>(putils::Point3d{ 4, 5, 6 });
+        em.execute();
+
+        const auto data = em.saveSnapshot();
+
+        EntityManager loaded;
+        loaded.registerCompLoader<InventoryComponent>();
+        loaded.registerCompLoader<TransformComponent3d>();
+        loaded.createEntity<GameObject>("replaced");
+        loaded.loadSnapshot(data.data(), data.size());
+        loaded.execute();
+
+        check(loaded.getGameObjects().size() == 2, "loading replaces all GameObjects");
+        check(!loaded.hasEntity("replaced"), "GameObjects that existed before the load are removed");
+        check(loaded.hasEntity("hero") && loaded.hasEntity("empty"), "names are kept");
+        if (!loaded.hasEntity("hero") || !loaded.hasEntity("empty"))
+            return;
+
+        const auto & loadedHero = static_cast<const GameObject &>(loaded.getEntity("hero"));
+        const auto & loadedInventory = loadedHero.getComponent<InventoryComponent>();
+        check(loadedInventory.gold == 42 && loadedInventory.weight == 12.5, "trivially copyable attributes are loaded");
+        check(loadedInventory.owner == inventory.owner, "strings are loaded");
+        check(loadedInventory.slots == inventory.slots, "vectors are loaded");
+        check(loadedInventory.items == inventory.items, "vectors of strings are loaded");
+        check(loadedHero.getComponent<TransformComponent3d>().boundingBox.topLeft.z == 3, "several Component types are loaded");
+
+        const auto & empty = static_cast<const GameObject &>(loaded.getEntity("empty"));
+        check(!empty.hasComponent<InventoryComponent>(), "no Component is attached to GameObjects that didn't have it");
+        check(empty.getComponent<TransformComponent3d>().boundingBox.topLeft.x == 4, "GameObjects are matched with their records");
+    }
+
+    void changedFields() {
+        EntityManager em;
+        em.registerCompLoader<before::StatsComponent>();
+        auto & stats = em.createEntity<GameObject>("hero").attachComponent<before::StatsComponent>();
+        stats.hp = 10;
+        stats.title = "knight";
+        stats.speed = 2;
+        em.execute();
+        const auto data = em.saveSnapshot();
+
+        EntityManager loaded;
+        loaded.registerCompLoader<after::StatsComponent>();
+        loaded.loadSnapshot(data.data(), data.size());
+        loaded.execute();
+
+        check(loaded.hasEntity("hero"), "GameObjects are loaded when their Components changed");
+        if (!loaded.hasEntity("hero"))
+            return;
+        const auto & hero = static_cast<const GameObject &>(loaded.getEntity("hero"));
+        check(hero.hasComponent<after::StatsComponent>(), "Components are matched by class name");
+        const auto & loadedStats = hero.getComponent<after::StatsComponent>();
+        check(loadedStats.hp == 10, "unchanged fields are loaded");
+        check(loadedStats.mana == 7, "added fields are left default-constructed");
+        check(loadedStats.speed == 3, "fields whose type changed are left default-constructed");
+    }
+
+    // Loading corrupt must throw Exception, without removing the existing GameObjects
+    template<typename Exception>
+    void checkRejected(std::vector<char> corrupt, const char * what) {
+        EntityManager em;
+        em.registerCompLoader<InventoryComponent>();
+        em.createEntity<GameObject>("existing");
+        em.execute();
+
+        bool thrown = false;
+        try {
+            em.loadSnapshot(corrupt.data(), corrupt.size());
+        }
+        catch (const Exception &) {
+            thrown = true;
+        }
+        em.execute();
+
+        check(thrown, what);
+        check(em.getGameObjects().size() == 1 && em.hasEntity("existing"), "GameObjects are left untouched by a failed load");
+    }
+
+    void corruptSnapshots() {
+        EntityManager em;
+        em.registerCompLoader<InventoryComponent>();
+        auto & inventory = em.createEntity<GameObject>("hero").attachComponent<InventoryComponent>();
+        inventory.owner = "owner";
+        em.execute();
+        const auto data = em.saveSnapshot();
+
+        snapshot::Header header;
+        std::memcpy(&header, data.data(), sizeof(header));
+        const auto withHeader = [&data](const snapshot::Header & h) {
+            auto ret = data;
+            std::memcpy(ret.data(), &h, sizeof(h));
+            return ret;
+        };
+
+        auto badMagic = header;
+        badMagic.magic[0] = 'X';
+        checkRejected<std::runtime_error>(withHeader(badMagic), "a bad magic number is rejected");
+
+        auto badVersion = header;
+        ++badVersion.version;
+        checkRejected<std::runtime_error>(withHeader(badVersion), "other versions are rejected");
+
+        checkRejected<std::out_of_range>(std::vector<char>(data.begin(), data.begin() + sizeof(header) - 1), "truncated headers are rejected");
+        checkRejected<std::out_of_range>(std::vector<char>(data.begin(), data.begin() + data.size() / 2), "truncated snapshots are rejected");
+
+        auto badTypes = header;
+        badTypes.typeCount = 1000000;
+        checkRejected<std::out_of_range>(withHeader(badTypes), "type tables outside of the file are rejected");
+
+        auto badBlob = header;
+        badBlob.blobSize = data.size();
+        checkRejected<std::out_of_range>(withHeader(badBlob), "blobs outside of the file are rejected");
+
+        // The hero's name points outside of the blob
+        auto badName = data;
+        snapshot::EntityEntry entry;
+        std::memcpy(&entry, data.data() + header.entitiesOffset, sizeof(entry));
+        entry.name.offset = header.blobSize;
+        entry.name.size = 1;
+        std::memcpy(badName.data() + header.entitiesOffset, &entry, sizeof(entry));
+        checkRejected<std::out_of_range>(badName, "spans outside of the blob are rejected");
+    }
+}
+
+int main() {
+    roundTrip();
+    changedFields();
+    corruptSnapshots();
+    return failures == 0 ? 0 : 1;
+}
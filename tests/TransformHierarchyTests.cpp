@@ -0,0 +1,78 @@
+#include <iostream>
+#include "EntityManager.hpp"
+
+using namespace kengine;
+
+namespace {
+    int failures = 0;
+
+    void check(bool condition, const char * what) {
+        if (!condition) {
+            std::cerr << "FAILED: " << what << std::endl;
+            ++failures;
+        }
+    }
+
+    const TransformComponent3d & getTransform(const GameObject & go) { return go.getComponent<TransformComponent3d>(); }
+
+    // A (transform) -> B (no transform) -> C (transform) -> D (transform)
+    void parentWithoutTransform() {
+        EntityManager em;
+        auto & a = em.createEntity<GameObject>("a");
+        a.attachComponent<TransformComponent3d>(putils::Point3d{ 1, 0, 0 });
+        auto & b = em.createEntity<GameObject>("b");
+        auto & c = em.createEntity<GameObject>("c");
+        c.attachComponent<TransformComponent3d>(putils::Point3d{ 5, 0, 0 });
+        auto & d = em.createEntity<GameObject>("d");
+        d.attachComponent<TransformComponent3d>(putils::Point3d{ 6, 0, 0 });
+
+        em.addLink(a, b);
+        em.addLink(b, c);
+        em.addLink(c, d);
+        em.execute();
+
+        a.getComponent<TransformComponent3d>().boundingBox.topLeft.x = 50;
+        c.getComponent<TransformComponent3d>().boundingBox.topLeft.x = 10;
+        em.execute();
+
+        check(getTransform(c).boundingBox.topLeft.x == 10, "a child whose parent has no transform is left as is");
+        check(getTransform(d).boundingBox.topLeft.x == 11, "its own children follow it");
+    }
+
+    void staticSubtrees() {
+        EntityManager em;
+        auto & moving = em.createEntity<GameObject>("moving");
+        moving.attachComponent<TransformComponent3d>();
+        auto & movingChild = em.createEntity<GameObject>("movingChild");
+        movingChild.attachComponent<TransformComponent3d>(putils::Point3d{ 0, 1, 0 });
+        auto & still = em.createEntity<GameObject>("still");
+        still.attachComponent<TransformComponent3d>();
+        auto & stillChild = em.createEntity<GameObject>("stillChild");
+        stillChild.attachComponent<TransformComponent3d>(putils::Point3d{ 0, 1, 0 });
+        auto & stillGrandChild = em.createEntity<GameObject>("stillGrandChild");
+        stillGrandChild.attachComponent<TransformComponent3d>(putils::Point3d{ 0, 2, 0 });
+
+        em.addLink(moving, movingChild);
+        em.addLink(still, stillChild);
+        em.addLink(stillChild, stillGrandChild);
+        em.execute();
+
+        moving.getComponent<TransformComponent3d>().boundingBox.topLeft.x = 3;
+        em.execute();
+        check(getTransform(movingChild).boundingBox.topLeft.x == 3, "children follow their parent");
+        check(getTransform(stillGrandChild).getChangeTick() < getTransform(movingChild).getChangeTick(), "static subtrees aren't updated");
+
+        // A direct write deep in a static subtree updates the local transform
+        stillGrandChild.getComponent<TransformComponent3d>().boundingBox.topLeft.x = 7;
+        em.execute();
+        still.getComponent<TransformComponent3d>().boundingBox.topLeft.x = 1;
+        em.execute();
+        check(getTransform(stillGrandChild).boundingBox.topLeft.x == 8, "direct writes to children are kept");
+    }
+}
+
+int main() {
+    parentWithoutTransform();
+    staticSubtrees();
+    return failures == 0 ? 0 : 1;
+}